@@ -0,0 +1,87 @@
+#include "Benchmark.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+namespace Benchmark
+{
+	namespace
+	{
+		struct Entry
+		{
+			std::string name;
+			Function function;
+		};
+
+		std::vector<Entry>& GetEntries()
+		{
+			static std::vector<Entry> entries;
+			return entries;
+		}
+	}
+
+	void Register(std::string name, Function function)
+	{
+		GetEntries().push_back(Entry{ std::move(name), std::move(function) });
+	}
+
+	void Run(const std::string& label, Database::Database& database, const std::string& filter)
+	{
+		std::cout << label << std::endl;
+
+		for (const Entry& entry : GetEntries())
+		{
+			if (entry.name.find(filter) == std::string::npos)
+			{
+				continue;
+			}
+
+			size_t iterations = 1;
+
+			while (true)
+			{
+				State state(iterations);
+				entry.function(state, database);
+
+				if (!state.get_skip_reason().empty())
+				{
+					std::cout << "  " << std::left << std::setw(32) << entry.name
+						<< "skipped: " << state.get_skip_reason() << std::endl;
+
+					break;
+				}
+
+				if (state.get_elapsed() < MinimumTime && iterations < 1000000000)
+				{
+					// aim slightly above the minimum time to avoid another run
+					const double multiplier = state.get_elapsed().count() > 0
+						? 1.4 * std::chrono::duration<double>(MinimumTime).count()
+							/ std::chrono::duration<double>(state.get_elapsed()).count()
+						: 10.0;
+
+					iterations = (size_t) (iterations * std::clamp(multiplier, 2.0, 10.0));
+					continue;
+				}
+
+				const double seconds = std::chrono::duration<double>(state.get_elapsed()).count();
+				const double nanoseconds = seconds * 1e9 / iterations;
+
+				std::cout << "  " << std::left << std::setw(32) << entry.name
+					<< std::right << std::setw(14) << std::fixed << std::setprecision(1)
+					<< nanoseconds << " ns"
+					<< std::setw(12) << iterations;
+
+				if (state.get_items_per_iteration() > 0)
+				{
+					std::cout << std::setw(14) << std::setprecision(0)
+						<< state.get_items_per_iteration() * iterations / seconds << " items/s";
+				}
+
+				std::cout << std::endl;
+				break;
+			}
+		}
+	}
+}
@@ -0,0 +1,123 @@
+#pragma once
+
+#include "DatabaseCore/DatabaseCore.h"
+
+#include <chrono>
+#include <functional>
+#include <string>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// small harness in the style of google benchmark. every benchmark runs
+// with growing iteration counts until it took at least MinimumTime
+namespace Benchmark
+{
+	typedef std::chrono::steady_clock Clock;
+
+	constexpr std::chrono::milliseconds MinimumTime{ 250 };
+
+	class State
+	{
+	public:
+		State(size_t iterations)
+			:
+			iterations(iterations),
+			remaining(iterations)
+		{
+		}
+
+		// while (state.keep_running()) { ... }
+		bool keep_running()
+		{
+			if (remaining == iterations)
+			{
+				begin = Clock::now();
+			}
+
+			if (remaining == 0)
+			{
+				elapsed += Clock::now() - begin;
+				return false;
+			}
+
+			--remaining;
+			return true;
+		}
+
+		// excludes setup inside of the loop from the measurement
+		void pause_timing()
+		{
+			elapsed += Clock::now() - begin;
+		}
+
+		void resume_timing()
+		{
+			begin = Clock::now();
+		}
+
+		// items per iteration. reported as items per second
+		void set_items_per_iteration(size_t items)
+		{
+			items_per_iteration = items;
+		}
+
+		void skip(std::string reason)
+		{
+			skip_reason = std::move(reason);
+			remaining = 0;
+		}
+
+		size_t get_iterations() const
+		{
+			return iterations;
+		}
+
+		Clock::duration get_elapsed() const
+		{
+			return elapsed;
+		}
+
+		size_t get_items_per_iteration() const
+		{
+			return items_per_iteration;
+		}
+
+		const std::string& get_skip_reason() const
+		{
+			return skip_reason;
+		}
+
+	private:
+		size_t iterations;
+		size_t remaining;
+		size_t items_per_iteration = 0;
+
+		Clock::time_point begin;
+		Clock::duration elapsed{ };
+
+		std::string skip_reason;
+	};
+
+	typedef std::function<void(State&, Database::Database&)> Function;
+
+	void Register(std::string name, Function function);
+
+	// runs every benchmark containing filter against database and
+	// prints one line per benchmark
+	void Run(const std::string& label, Database::Database& database, const std::string& filter);
+
+	// keeps the compiler from removing the computation of value
+	template <typename T>
+	inline void DoNotOptimize(const T& value)
+	{
+#ifdef _MSC_VER
+		const volatile char* const sink = reinterpret_cast<const volatile char*>(&value);
+		(void) *sink;
+		_ReadWriteBarrier();
+#else
+		asm volatile("" : : "g"(&value) : "memory");
+#endif
+	}
+}
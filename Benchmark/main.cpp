@@ -0,0 +1,660 @@
+#include "Benchmark.h"
+
+#include "DatabaseCore/ColumnKernels.h"
+
+#include <cstdio>
+#include <iostream>
+#include <memory>
+#include <random>
+
+/*
+
+Usage:
+	Benchmark [filter]
+
+	Runs every benchmark whose name contains filter against an in memory
+	and an on disk database. Data is generated with a fixed seed, so runs
+	are comparable.
+
+*/
+
+constexpr SQLiteInt RowCount = 10000;
+constexpr size_t TextSize = 64;
+constexpr size_t BlobSize = 256;
+constexpr size_t LargeBlobSize = 4 * 1024 * 1024;
+constexpr std::mt19937_64::result_type Seed = 0x5EED;
+
+const char* const DiskFilename = "benchmark.db";
+
+void register_prepare();
+void register_bind();
+void register_extract();
+void register_scan();
+void register_execute();
+void register_kernel();
+
+bool setup(Database::Database& database);
+
+int main(int argc, char** argv)
+{
+	const std::string filter = argc > 1 ? argv[1] : "";
+
+	register_prepare();
+	register_bind();
+	register_extract();
+	register_scan();
+	register_execute();
+	register_kernel();
+
+	{
+		Database::Database memory(":memory:");
+
+		if (!memory || !setup(memory))
+		{
+			std::cout << "Failed to setup in memory database" << std::endl;
+			return 0;
+		}
+
+		Benchmark::Run(":memory:", memory, filter);
+	}
+
+	std::remove(DiskFilename);
+
+	{
+		Database::Database disk(DiskFilename);
+
+		if (!disk || !setup(disk))
+		{
+			std::cout << "Failed to setup on disk database" << std::endl;
+			return 0;
+		}
+
+		Benchmark::Run(DiskFilename, disk, filter);
+	}
+
+	std::remove(DiskFilename);
+}
+
+SQLiteString random_text(std::mt19937_64& random, size_t size)
+{
+	std::uniform_int_distribution<int> character('a', 'z');
+	SQLiteString text(size, ' ');
+
+	for (char& c : text)
+		c = (char) character(random);
+
+	return text;
+}
+
+SQLiteBlob random_blob(std::mt19937_64& random, size_t size)
+{
+	std::uniform_int_distribution<int> byte(0, 255);
+	SQLiteBlob blob(size);
+
+	for (unsigned char& b : blob)
+		b = (unsigned char) byte(random);
+
+	return blob;
+}
+
+std::wstring random_wide_text(std::mt19937_64& random, size_t size)
+{
+	const SQLiteString text = random_text(random, size);
+	return std::wstring(text.begin(), text.end());
+}
+
+bool setup(Database::Database& database)
+{
+	if (!Database::Statement<>(
+			&database,
+			"CREATE TABLE bench ("
+			"id INTEGER PRIMARY KEY, "
+			"i INTEGER, r REAL, t TEXT, b BLOB, w BLOB, n TEXT)").execute()
+		|| !Database::Statement<>(
+			&database,
+			"CREATE TABLE bench_insert (id INTEGER, t TEXT)").execute())
+	{
+		return false;
+	}
+
+	std::mt19937_64 random(Seed);
+	std::uniform_int_distribution<SQLiteInt> integer;
+	std::uniform_real_distribution<SQLiteReal> real;
+
+	typedef std::tuple<SQLiteInt, SQLiteInt, SQLiteReal, SQLiteString,
+		SQLiteBlob, std::wstring, std::optional<SQLiteString>> Row;
+
+	std::vector<Row> rows;
+	rows.reserve(RowCount);
+
+	for (SQLiteInt id = 0; id < RowCount; ++id)
+	{
+		rows.emplace_back(
+			id,
+			integer(random),
+			real(random),
+			random_text(random, TextSize),
+			random_blob(random, BlobSize),
+			random_wide_text(random, TextSize),
+			// every second row has a null value
+			id % 2 == 0
+				? std::optional<SQLiteString>(random_text(random, TextSize))
+				: std::nullopt);
+	}
+
+	return database.bulk_insert<SQLiteInt, SQLiteInt, SQLiteReal, SQLiteString,
+		SQLiteBlob, std::wstring, std::optional<SQLiteString>>(
+			"INSERT INTO bench (id, i, r, t, b, w, n) VALUES (?, ?, ?, ?, ?, ?, ?)",
+			rows);
+}
+
+void register_prepare()
+{
+	Benchmark::Register("prepare/uncached", [](Benchmark::State& state, Database::Database& database)
+		{
+			Database::SQLiteStatementCache& cache = database.get_statement_cache();
+			const size_t capacity = cache.get_capacity();
+
+			cache.set_capacity(0);
+
+			while (state.keep_running())
+			{
+				Database::Statement<SQLiteInt, SQLiteString> statement(
+					&database,
+					"SELECT i, t FROM bench WHERE id = ?");
+
+				Benchmark::DoNotOptimize(statement);
+			}
+
+			cache.set_capacity(capacity);
+		});
+
+	Benchmark::Register("prepare/cached", [](Benchmark::State& state, Database::Database& database)
+		{
+			while (state.keep_running())
+			{
+				Database::Statement<SQLiteInt, SQLiteString> statement(
+					&database,
+					"SELECT i, t FROM bench WHERE id = ?");
+
+				Benchmark::DoNotOptimize(statement);
+			}
+		});
+}
+
+// binds value to a reused statement without stepping it
+template <typename T>
+void register_bind_as(const char* name, T value)
+{
+	Benchmark::Register(name, [value](Benchmark::State& state, Database::Database& database)
+		{
+			Database::Statement<> statement(&database, "SELECT ?");
+
+			while (state.keep_running())
+			{
+				statement.bind(0, value);
+			}
+		});
+}
+
+void register_bind()
+{
+	std::mt19937_64 random(Seed);
+
+	register_bind_as("bind/int", SQLiteInt{ 42 });
+	register_bind_as("bind/real", SQLiteReal{ 4.2 });
+	register_bind_as("bind/text", random_text(random, TextSize));
+	register_bind_as("bind/text_view", SQLiteStringView("benchmark text view"));
+	register_bind_as("bind/blob", random_blob(random, BlobSize));
+	register_bind_as("bind/wide_text", random_wide_text(random, TextSize));
+	register_bind_as("bind/optional_null", std::optional<SQLiteString>());
+	register_bind_as("bind/optional_text", std::optional<SQLiteString>(random_text(random, TextSize)));
+
+	const std::shared_ptr<SQLiteBlob> large_blob = std::make_shared<SQLiteBlob>(
+		random_blob(random, LargeBlobSize));
+
+	Benchmark::Register("bind/large_blob", [large_blob](Benchmark::State& state, Database::Database& database)
+		{
+			Database::Statement<> statement(&database, "SELECT ?");
+
+			while (state.keep_running())
+			{
+				statement.bind(0, *large_blob);
+			}
+		});
+
+	Benchmark::Register("bind/large_blob_static", [large_blob](Benchmark::State& state, Database::Database& database)
+		{
+			Database::Statement<> statement(&database, "SELECT ?");
+
+			while (state.keep_running())
+			{
+				statement.bind(0, Database::Borrowed(*large_blob));
+			}
+		});
+}
+
+// extracts column of a single row repeatedly, without stepping
+template <typename T>
+void register_extract_as(const char* name, const char* column)
+{
+	const std::string query = std::string("SELECT ") + column + " FROM bench WHERE id = 42";
+
+	Benchmark::Register(name, [query](Benchmark::State& state, Database::Database& database)
+		{
+			typedef std::tuple<T> Tuple;
+
+			Database::Statement<Tuple> statement(&database, query);
+			Tuple tuple;
+
+			if (!statement.step())
+			{
+				state.skip("no row");
+				return;
+			}
+
+			while (state.keep_running())
+			{
+				Database::SQLiteStatementColumnTuple<Tuple>::Extract(tuple, statement.get_statement());
+				Benchmark::DoNotOptimize(tuple);
+			}
+		});
+}
+
+void register_extract()
+{
+	register_extract_as<SQLiteInt>("extract/int", "i");
+	register_extract_as<SQLiteReal>("extract/real", "r");
+	register_extract_as<SQLiteString>("extract/text", "t");
+	register_extract_as<SQLiteStringView>("extract/text_view", "t");
+	register_extract_as<SQLiteBlob>("extract/blob", "b");
+	register_extract_as<SQLiteBlobView>("extract/blob_view", "b");
+	register_extract_as<std::wstring>("extract/wide_text", "w");
+	register_extract_as<std::optional<SQLiteString>>("extract/optional_text", "n");
+}
+
+void register_scan()
+{
+	Benchmark::Register("scan/iterator", [](Benchmark::State& state, Database::Database& database)
+		{
+			state.set_items_per_iteration(RowCount);
+
+			while (state.keep_running())
+			{
+				Database::Statement<SQLiteInt, SQLiteReal, SQLiteString, SQLiteBlob> statement(
+					&database,
+					"SELECT i, r, t, b FROM bench");
+
+				for (const auto& row : statement)
+				{
+					Benchmark::DoNotOptimize(row);
+				}
+			}
+		});
+
+	Benchmark::Register("scan/iterator_views", [](Benchmark::State& state, Database::Database& database)
+		{
+			state.set_items_per_iteration(RowCount);
+
+			while (state.keep_running())
+			{
+				Database::Statement<SQLiteInt, SQLiteReal, SQLiteStringView, SQLiteBlobView> statement(
+					&database,
+					"SELECT i, r, t, b FROM bench");
+
+				for (const auto& row : statement)
+				{
+					Benchmark::DoNotOptimize(row);
+				}
+			}
+		});
+
+	Benchmark::Register("scan/numeric_iterator", [](Benchmark::State& state, Database::Database& database)
+		{
+			state.set_items_per_iteration(RowCount);
+
+			while (state.keep_running())
+			{
+				Database::Statement<SQLiteInt, SQLiteReal> statement(
+					&database,
+					"SELECT i, r FROM bench");
+
+				std::vector<SQLiteInt> integers;
+				std::vector<SQLiteReal> reals;
+
+				for (const auto& [integer, real] : statement)
+				{
+					integers.push_back(integer);
+					reals.push_back(real);
+				}
+
+				Benchmark::DoNotOptimize(integers);
+				Benchmark::DoNotOptimize(reals);
+			}
+		});
+
+	Benchmark::Register("scan/numeric_fetch_batch", [](Benchmark::State& state, Database::Database& database)
+		{
+			state.set_items_per_iteration(RowCount);
+
+			while (state.keep_running())
+			{
+				Database::Statement<SQLiteInt, SQLiteReal> statement(
+					&database,
+					"SELECT i, r FROM bench");
+
+				auto batch = statement.fetch_batch(RowCount);
+				Benchmark::DoNotOptimize(batch);
+			}
+		});
+
+	Benchmark::Register("scan/collect_copy", [](Benchmark::State& state, Database::Database& database)
+		{
+			typedef std::tuple<SQLiteInt, SQLiteString, SQLiteBlob> Row;
+			state.set_items_per_iteration(RowCount);
+
+			while (state.keep_running())
+			{
+				Database::Statement<Row> statement(
+					&database,
+					"SELECT i, t, b FROM bench");
+
+				std::vector<Row> rows;
+				rows.reserve(RowCount);
+
+				for (const Row& row : statement)
+				{
+					rows.push_back(row);
+				}
+
+				Benchmark::DoNotOptimize(rows);
+			}
+		});
+
+	Benchmark::Register("scan/collect_move", [](Benchmark::State& state, Database::Database& database)
+		{
+			typedef std::tuple<SQLiteInt, SQLiteString, SQLiteBlob> Row;
+			state.set_items_per_iteration(RowCount);
+
+			while (state.keep_running())
+			{
+				Database::Statement<Row> statement(
+					&database,
+					"SELECT i, t, b FROM bench");
+
+				std::vector<Row> rows;
+				rows.reserve(RowCount);
+
+				for (Row&& row : statement.consume())
+				{
+					rows.push_back(std::move(row));
+				}
+
+				Benchmark::DoNotOptimize(rows);
+			}
+		});
+
+	Benchmark::Register("scan/collect_arena", [](Benchmark::State& state, Database::Database& database)
+		{
+			typedef Database::Statement<SQLiteInt, SQLiteString, SQLiteBlob> Statement;
+			state.set_items_per_iteration(RowCount);
+
+			// reused like by a request handler
+			Database::SQLiteArena arena;
+			std::vector<Statement::ArenaRow> rows;
+
+			while (state.keep_running())
+			{
+				Statement statement(
+					&database,
+					"SELECT i, t, b FROM bench");
+
+				arena.clear();
+				rows.clear();
+
+				statement.collect(arena, rows);
+				Benchmark::DoNotOptimize(rows);
+			}
+		});
+
+	Benchmark::Register("scan/iterator_optional", [](Benchmark::State& state, Database::Database& database)
+		{
+			state.set_items_per_iteration(RowCount);
+
+			while (state.keep_running())
+			{
+				Database::Statement<std::optional<SQLiteString>> statement(
+					&database,
+					"SELECT n FROM bench");
+
+				for (const auto& row : statement)
+				{
+					Benchmark::DoNotOptimize(row);
+				}
+			}
+		});
+}
+
+void register_execute()
+{
+	Benchmark::Register("execute/lookup_prepare", [](Benchmark::State& state, Database::Database& database)
+		{
+			std::mt19937_64 random(Seed);
+			std::uniform_int_distribution<SQLiteInt> id(0, RowCount - 1);
+			SQLiteString text;
+
+			// every statement is prepared again
+			Database::SQLiteStatementCache& cache = database.get_statement_cache();
+			const size_t capacity = cache.get_capacity();
+
+			cache.set_capacity(0);
+
+			while (state.keep_running())
+			{
+				Database::Statement<SQLiteString>(
+					&database,
+					"SELECT t FROM bench WHERE id = ?",
+					id(random)).execute(text);
+			}
+
+			cache.set_capacity(capacity);
+		});
+
+	Benchmark::Register("execute/lookup_cached", [](Benchmark::State& state, Database::Database& database)
+		{
+			std::mt19937_64 random(Seed);
+			std::uniform_int_distribution<SQLiteInt> id(0, RowCount - 1);
+			SQLiteString text;
+
+			while (state.keep_running())
+			{
+				Database::Statement<SQLiteString>(
+					&database,
+					"SELECT t FROM bench WHERE id = ?",
+					id(random)).execute(text);
+			}
+		});
+
+	Benchmark::Register("execute/lookup_reuse", [](Benchmark::State& state, Database::Database& database)
+		{
+			std::mt19937_64 random(Seed);
+			std::uniform_int_distribution<SQLiteInt> id(0, RowCount - 1);
+			SQLiteString text;
+
+			Database::Statement<SQLiteString> statement(
+				&database,
+				"SELECT t FROM bench WHERE id = ?");
+
+			while (state.keep_running())
+			{
+				statement.reset();
+				statement.bind(id(random));
+				statement.execute(text);
+			}
+		});
+
+	Benchmark::Register("execute/insert_prepare", [](Benchmark::State& state, Database::Database& database)
+		{
+			const SQLiteString text = "benchmark row";
+			Database::Transaction transaction(&database);
+
+			// every statement is prepared again
+			Database::SQLiteStatementCache& cache = database.get_statement_cache();
+			const size_t capacity = cache.get_capacity();
+
+			cache.set_capacity(0);
+
+			SQLiteInt id = 0;
+
+			while (state.keep_running())
+			{
+				Database::Statement<>(
+					&database,
+					"INSERT INTO bench_insert (id, t) VALUES (?, ?)",
+					id++, text).execute();
+			}
+
+			cache.set_capacity(capacity);
+		});
+
+	Benchmark::Register("execute/insert_cached", [](Benchmark::State& state, Database::Database& database)
+		{
+			const SQLiteString text = "benchmark row";
+			Database::Transaction transaction(&database);
+
+			SQLiteInt id = 0;
+
+			while (state.keep_running())
+			{
+				Database::Statement<>(
+					&database,
+					"INSERT INTO bench_insert (id, t) VALUES (?, ?)",
+					id++, text).execute();
+			}
+		});
+
+	Benchmark::Register("execute/insert_reuse", [](Benchmark::State& state, Database::Database& database)
+		{
+			const SQLiteString text = "benchmark row";
+			Database::Transaction transaction(&database);
+
+			Database::Statement<> statement(
+				&database,
+				"INSERT INTO bench_insert (id, t) VALUES (?, ?)");
+
+			SQLiteInt id = 0;
+
+			while (state.keep_running())
+			{
+				statement.reset();
+				statement.bind(id++, text);
+				statement.execute();
+			}
+		});
+
+	Benchmark::Register("execute/bulk_insert", [](Benchmark::State& state, Database::Database& database)
+		{
+			std::vector<std::tuple<SQLiteInt, SQLiteString>> rows;
+
+			for (SQLiteInt id = 0; id < 1000; ++id)
+			{
+				rows.emplace_back(id, "benchmark row");
+			}
+
+			state.set_items_per_iteration(rows.size());
+
+			while (state.keep_running())
+			{
+				database.bulk_insert<SQLiteInt, SQLiteString>(
+					"INSERT INTO bench_insert (id, t) VALUES (?, ?)",
+					rows);
+			}
+		});
+}
+
+// runs kernel once per kernel level over the numeric columns of bench.
+// the columns are fetched once, only the kernel is measured
+template <typename Kernel>
+void register_kernel_at(const std::string& name, Kernel kernel)
+{
+	const std::pair<const char*, Database::SQLiteKernelLevel> levels[] =
+	{
+		{ "scalar", Database::SQLiteKernelLevel::Scalar },
+		{ "avx2", Database::SQLiteKernelLevel::AVX2 },
+		{ "avx512", Database::SQLiteKernelLevel::AVX512 }
+	};
+
+	for (const auto& [level_name, level] : levels)
+	{
+		Benchmark::Register(name + "/" + level_name, [kernel, level = level](Benchmark::State& state, Database::Database& database) mutable
+			{
+				if (level > Database::GetSupportedKernelLevel())
+				{
+					state.skip("not supported by this cpu");
+					return;
+				}
+
+				Database::Statement<SQLiteInt, SQLiteReal> statement(
+					&database,
+					"SELECT i, r FROM bench");
+
+				const auto batch = statement.fetch_batch(RowCount);
+
+				const Database::SQLiteKernelLevel previous = Database::GetKernelLevel();
+				Database::SetKernelLevel(level);
+
+				state.set_items_per_iteration(batch.size());
+
+				while (state.keep_running())
+				{
+					kernel(batch.get_column<0>(), batch.get_column<1>());
+				}
+
+				Database::SetKernelLevel(previous);
+			});
+	}
+}
+
+void register_kernel()
+{
+	register_kernel_at("kernel/sum_int", [](const std::vector<SQLiteInt>& integers, const std::vector<SQLiteReal>&)
+		{
+			Benchmark::DoNotOptimize(Database::ColumnSum(integers));
+		});
+
+	register_kernel_at("kernel/sum_real", [](const std::vector<SQLiteInt>&, const std::vector<SQLiteReal>& reals)
+		{
+			Benchmark::DoNotOptimize(Database::ColumnSum(reals));
+		});
+
+	register_kernel_at("kernel/min_max_int", [](const std::vector<SQLiteInt>& integers, const std::vector<SQLiteReal>&)
+		{
+			Benchmark::DoNotOptimize(Database::ColumnMinMax(integers));
+		});
+
+	register_kernel_at("kernel/min_max_real", [](const std::vector<SQLiteInt>&, const std::vector<SQLiteReal>& reals)
+		{
+			Benchmark::DoNotOptimize(Database::ColumnMinMax(reals));
+		});
+
+	register_kernel_at("kernel/filter_int", [selection = std::vector<uint32_t>()](
+		const std::vector<SQLiteInt>& integers, const std::vector<SQLiteReal>&) mutable
+		{
+			Database::ColumnFilter(integers, Database::SQLiteCompare::Greater, (SQLiteInt) 0, selection);
+			Benchmark::DoNotOptimize(selection);
+		});
+
+	register_kernel_at("kernel/filter_real", [selection = std::vector<uint32_t>()](
+		const std::vector<SQLiteInt>&, const std::vector<SQLiteReal>& reals) mutable
+		{
+			Database::ColumnFilter(reals, Database::SQLiteCompare::Less, 0.5, selection);
+			Benchmark::DoNotOptimize(selection);
+		});
+
+	register_kernel_at("kernel/histogram_real", [bins = std::vector<size_t>(64)](
+		const std::vector<SQLiteInt>&, const std::vector<SQLiteReal>& reals) mutable
+		{
+			Database::ColumnHistogram(reals, 0.0, 1.0, bins);
+			Benchmark::DoNotOptimize(bins);
+		});
+}
@@ -0,0 +1,532 @@
+#include "Allocator.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <vector>
+
+namespace Database
+{
+	namespace
+	{
+		constexpr size_t SizeClasses[] =
+		{
+			16, 32, 48, 64, 96, 128, 192, 256, 384, 512, 768, 1024,
+			1536, 2048, 3072, 4096, 6144, 8192, 12288, 16384
+		};
+
+		constexpr uint32_t ClassCount = sizeof(SizeClasses) / sizeof(SizeClasses[0]);
+		constexpr uint32_t LargeClass = ClassCount;
+		constexpr size_t MaxClassSize = SizeClasses[ClassCount - 1];
+
+		// size classes are looked up in steps of 16 bytes
+		constexpr size_t Granularity = 16;
+
+		constexpr std::array<uint8_t, MaxClassSize / Granularity + 1> MakeClassTable()
+		{
+			std::array<uint8_t, MaxClassSize / Granularity + 1> table{ };
+			uint8_t size_class = 0;
+
+			for (size_t step = 0; step < table.size(); ++step)
+			{
+				while (SizeClasses[size_class] < step * Granularity)
+					++size_class;
+
+				table[step] = size_class;
+			}
+
+			return table;
+		}
+
+		constexpr auto ClassTable = MakeClassTable();
+
+		uint32_t GetSizeClass(size_t size)
+		{
+			return ClassTable[(size + Granularity - 1) / Granularity];
+		}
+
+		// precedes every allocation and keeps it 16 byte aligned
+		struct alignas(16) Header
+		{
+			// requested size of large allocations
+			uint64_t size;
+			uint32_t size_class;
+		};
+
+		static_assert(sizeof(Header) == 16, "allocator header has to keep alignment");
+
+		struct FreeBlock
+		{
+			FreeBlock* next;
+		};
+
+		struct FreeList
+		{
+			FreeBlock* head = nullptr;
+			size_t count = 0;
+
+			void push(FreeBlock* block)
+			{
+				block->next = head;
+				head = block;
+				++count;
+			}
+
+			FreeBlock* pop()
+			{
+				FreeBlock* const block = head;
+				head = block->next;
+				--count;
+
+				return block;
+			}
+		};
+
+		struct Counters
+		{
+			std::atomic<uint64_t> allocations{ 0 };
+			std::atomic<uint64_t> frees{ 0 };
+			std::atomic<uint64_t> large_allocations{ 0 };
+			std::atomic<uint64_t> refills{ 0 };
+			std::atomic<uint64_t> flushes{ 0 };
+			std::atomic<uint64_t> bytes_allocated{ 0 };
+			std::atomic<uint64_t> bytes_freed{ 0 };
+
+			void add(const Counters& other)
+			{
+				allocations += other.allocations.load(std::memory_order_relaxed);
+				frees += other.frees.load(std::memory_order_relaxed);
+				large_allocations += other.large_allocations.load(std::memory_order_relaxed);
+				refills += other.refills.load(std::memory_order_relaxed);
+				flushes += other.flushes.load(std::memory_order_relaxed);
+				bytes_allocated += other.bytes_allocated.load(std::memory_order_relaxed);
+				bytes_freed += other.bytes_freed.load(std::memory_order_relaxed);
+			}
+		};
+
+		// counters are only written by their own thread, so they are
+		// increased without a locked instruction
+		void Increase(std::atomic<uint64_t>& counter, uint64_t value = 1)
+		{
+			counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+		}
+
+		struct ThreadCache;
+
+		struct Allocator
+		{
+			SQLiteAllocatorOptions options;
+			std::atomic<bool> installed{ false };
+
+			// shared pools of free blocks per size class
+			std::mutex pool_mutexes[ClassCount];
+			FreeList pools[ClassCount];
+			std::atomic<uint64_t> bytes_reserved{ 0 };
+
+			// live thread caches and the counters of exited threads
+			std::mutex cache_mutex;
+			std::vector<ThreadCache*> caches;
+			Counters retired;
+		};
+
+		// never destroyed, sqlite can still free memory during static
+		// destruction and blocks are kept until the process exits
+		Allocator& GetAllocator()
+		{
+			static Allocator* const allocator = new Allocator;
+			return *allocator;
+		}
+
+		size_t GetBlockSize(uint32_t size_class)
+		{
+			return sizeof(Header) + SizeClasses[size_class];
+		}
+
+		// moves up to count blocks of the shared pool into list and
+		// reserves a new chunk if the pool is empty
+		void Refill(FreeList& list, uint32_t size_class, size_t count)
+		{
+			Allocator& allocator = GetAllocator();
+			std::lock_guard<std::mutex> lock(allocator.pool_mutexes[size_class]);
+
+			FreeList& pool = allocator.pools[size_class];
+
+			if (pool.count < count)
+			{
+				const size_t block_size = GetBlockSize(size_class);
+				const size_t chunk_size = std::max(allocator.options.chunk_size, block_size * count);
+
+				char* const chunk = (char*) malloc(chunk_size);
+
+				if (chunk)
+				{
+					for (size_t offset = 0; offset + block_size <= chunk_size; offset += block_size)
+					{
+						pool.push((FreeBlock*) (chunk + offset));
+					}
+
+					allocator.bytes_reserved += chunk_size;
+				}
+			}
+
+			while (count-- > 0 && pool.head)
+			{
+				list.push(pool.pop());
+			}
+		}
+
+		// moves count blocks of list back into the shared pool
+		void Flush(FreeList& list, uint32_t size_class, size_t count)
+		{
+			Allocator& allocator = GetAllocator();
+			std::lock_guard<std::mutex> lock(allocator.pool_mutexes[size_class]);
+
+			FreeList& pool = allocator.pools[size_class];
+
+			while (count-- > 0 && list.head)
+			{
+				pool.push(list.pop());
+			}
+		}
+
+		struct ThreadCache
+		{
+			FreeList lists[ClassCount];
+			Counters counters;
+
+			ThreadCache()
+			{
+				Allocator& allocator = GetAllocator();
+				std::lock_guard<std::mutex> lock(allocator.cache_mutex);
+
+				allocator.caches.push_back(this);
+			}
+
+			~ThreadCache();
+		};
+
+		// set once the cache of this thread is destroyed. sqlite can
+		// still allocate afterwards, for example in thread_local
+		// destructors, which then go to the shared pool directly
+		thread_local bool thread_cache_destroyed = false;
+
+		ThreadCache::~ThreadCache()
+		{
+			for (uint32_t size_class = 0; size_class < ClassCount; ++size_class)
+			{
+				Flush(lists[size_class], size_class, lists[size_class].count);
+			}
+
+			Allocator& allocator = GetAllocator();
+			std::lock_guard<std::mutex> lock(allocator.cache_mutex);
+
+			allocator.retired.add(counters);
+			allocator.caches.erase(std::find(allocator.caches.begin(), allocator.caches.end(), this));
+
+			thread_cache_destroyed = true;
+		}
+
+		ThreadCache* GetThreadCache()
+		{
+			if (thread_cache_destroyed)
+			{
+				return nullptr;
+			}
+
+			thread_local ThreadCache cache;
+			return &cache;
+		}
+
+		void* Malloc(int requested_size)
+		{
+			const size_t size = requested_size > 0 ? requested_size : 1;
+			ThreadCache* const cache = GetThreadCache();
+
+			Header* header;
+
+			if (size > MaxClassSize)
+			{
+				header = (Header*) malloc(sizeof(Header) + size);
+
+				if (header == NULL)
+				{
+					return NULL;
+				}
+
+				header->size = size;
+				header->size_class = LargeClass;
+
+				if (cache)
+					Increase(cache->counters.large_allocations);
+			}
+			else
+			{
+				const uint32_t size_class = GetSizeClass(size);
+				FreeList local;
+				FreeList& list = cache ? cache->lists[size_class] : local;
+
+				if (list.head == nullptr)
+				{
+					Refill(list, size_class, cache
+						? std::max<size_t>(GetAllocator().options.thread_cache_size / 2, 1)
+						: 1);
+
+					if (list.head == nullptr)
+					{
+						return NULL;
+					}
+
+					if (cache)
+						Increase(cache->counters.refills);
+				}
+
+				header = (Header*) list.pop();
+				header->size = SizeClasses[size_class];
+				header->size_class = size_class;
+			}
+
+			if (cache)
+			{
+				Increase(cache->counters.allocations);
+				Increase(cache->counters.bytes_allocated, header->size);
+			}
+
+			return header + 1;
+		}
+
+		void Free(void* memory)
+		{
+			if (memory == NULL)
+			{
+				return;
+			}
+
+			Header* const header = (Header*) memory - 1;
+			ThreadCache* const cache = GetThreadCache();
+
+			if (cache)
+			{
+				Increase(cache->counters.frees);
+				Increase(cache->counters.bytes_freed, header->size);
+			}
+
+			const uint32_t size_class = header->size_class;
+
+			if (size_class == LargeClass)
+			{
+				free(header);
+				return;
+			}
+
+			FreeBlock* const block = (FreeBlock*) header;
+
+			if (cache == nullptr)
+			{
+				FreeList local;
+				local.push(block);
+
+				Flush(local, size_class, 1);
+				return;
+			}
+
+			FreeList& list = cache->lists[size_class];
+			list.push(block);
+
+			const size_t thread_cache_size = GetAllocator().options.thread_cache_size;
+
+			if (list.count > thread_cache_size)
+			{
+				Flush(list, size_class, thread_cache_size / 2);
+				Increase(cache->counters.flushes);
+			}
+		}
+
+		int Size(void* memory)
+		{
+			return memory ? (int) ((Header*) memory - 1)->size : 0;
+		}
+
+		int Roundup(int size)
+		{
+			if (size <= 0)
+			{
+				return (int) SizeClasses[0];
+			}
+
+			if ((size_t) size > MaxClassSize)
+			{
+				return (size + 7) & ~7;
+			}
+
+			return (int) SizeClasses[GetSizeClass(size)];
+		}
+
+		void* Realloc(void* memory, int requested_size)
+		{
+			if (memory == NULL)
+			{
+				return Malloc(requested_size);
+			}
+
+			const size_t size = requested_size > 0 ? requested_size : 1;
+			Header* const header = (Header*) memory - 1;
+
+			// blocks stay in their size class
+			if (header->size_class != LargeClass
+				&& size <= MaxClassSize
+				&& GetSizeClass(size) == header->size_class)
+			{
+				return memory;
+			}
+
+			void* const resized = Malloc(requested_size);
+
+			if (resized == NULL)
+			{
+				return NULL;
+			}
+
+			memcpy(resized, memory, std::min<size_t>(header->size, size));
+			Free(memory);
+
+			return resized;
+		}
+
+		int Init(void*)
+		{
+			return SQLITE_OK;
+		}
+
+		void Shutdown(void*)
+		{
+		}
+
+		const sqlite3_mem_methods Methods =
+		{
+			Malloc,
+			Free,
+			Realloc,
+			Size,
+			Roundup,
+			Init,
+			Shutdown,
+			NULL
+		};
+
+		// backs SQLITE_CONFIG_PAGECACHE. never freed like the allocator,
+		// connections can still use it during static destruction. a
+		// later configuration leaks the previous buffer, since sqlite
+		// also accepts it after a shutdown that left connections open
+		char* page_cache = NULL;
+	}
+
+	bool InstallSQLiteAllocator(const SQLiteAllocatorOptions& options)
+	{
+		Allocator& allocator = GetAllocator();
+
+		if (!EnsureSQLiteStatusCode(
+				sqlite3_config(SQLITE_CONFIG_MALLOC, &Methods),
+				"failed to install sqlite allocator"))
+		{
+			return false;
+		}
+
+		allocator.options = options;
+		allocator.options.thread_cache_size = std::max<size_t>(options.thread_cache_size, 2);
+		allocator.installed = true;
+
+		return EnsureSQLiteStatusCode(
+			sqlite3_config(SQLITE_CONFIG_MEMSTATUS, options.memory_status ? 1 : 0),
+			"failed to configure sqlite memory status");
+	}
+
+	bool IsSQLiteAllocatorInstalled()
+	{
+		return GetAllocator().installed;
+	}
+
+	SQLiteAllocatorStatistics GetSQLiteAllocatorStatistics()
+	{
+		Allocator& allocator = GetAllocator();
+
+		Counters counters;
+
+		{
+			std::lock_guard<std::mutex> lock(allocator.cache_mutex);
+			counters.add(allocator.retired);
+
+			for (const ThreadCache* cache : allocator.caches)
+			{
+				counters.add(cache->counters);
+			}
+		}
+
+		// allocations and frees of the same block can be counted on
+		// different threads
+		const uint64_t allocated = counters.bytes_allocated;
+		const uint64_t freed = counters.bytes_freed;
+
+		return SQLiteAllocatorStatistics
+		{
+			counters.allocations,
+			counters.frees,
+			counters.large_allocations,
+			counters.refills,
+			counters.flushes,
+			allocated > freed ? allocated - freed : 0,
+			allocator.bytes_reserved
+		};
+	}
+
+	bool ConfigureSQLitePageCache(int page_size, int pages)
+	{
+		if (pages <= 0)
+		{
+			return EnsureSQLiteStatusCode(
+				sqlite3_config(SQLITE_CONFIG_PAGECACHE, NULL, 0, 0),
+				"failed to disable sqlite page cache");
+		}
+
+		int header_size = 0;
+
+		if (!EnsureSQLiteStatusCode(
+				sqlite3_config(SQLITE_CONFIG_PCACHE_HDRSZ, &header_size),
+				"failed to get sqlite page cache header size"))
+		{
+			return false;
+		}
+
+		const int slot_size = (page_size + header_size + 7) & ~7;
+		char* const buffer = new char[(size_t) slot_size * pages];
+
+		if (!EnsureSQLiteStatusCode(
+				sqlite3_config(SQLITE_CONFIG_PAGECACHE, buffer, slot_size, pages),
+				"failed to configure sqlite page cache"))
+		{
+			delete[] buffer;
+			return false;
+		}
+
+		page_cache = buffer;
+
+		return true;
+	}
+
+	bool ConfigureSQLiteLookaside(int slot_size, int slots)
+	{
+		return EnsureSQLiteStatusCode(
+			sqlite3_config(SQLITE_CONFIG_LOOKASIDE, slot_size, slots),
+			"failed to configure sqlite lookaside");
+	}
+
+	bool ConfigureSQLiteLookaside(SQLiteDatabase& database, int slot_size, int slots)
+	{
+		// sqlite allocates the slots itself if no buffer is given
+		return EnsureSQLiteStatusCode(
+			sqlite3_db_config(database.get_database(), SQLITE_DBCONFIG_LOOKASIDE, NULL, slot_size, slots),
+			"failed to configure sqlite connection lookaside");
+	}
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "DatabaseCore.h"
+
+#include <cstdint>
+
+// process wide memory configuration of sqlite. sqlite only accepts it
+// before it is initialized, which happens implicitly with the first
+// sqlite3_open, so it has to run before any SQLiteDatabase is opened
+namespace Database
+{
+	struct SQLiteAllocatorOptions
+	{
+		// free blocks every thread keeps per size class before half of
+		// them are given back to the shared pool
+		size_t thread_cache_size = 64;
+		// memory the shared pool reserves at once for a size class
+		size_t chunk_size = 64 * 1024;
+		// sqlite tracks memory for sqlite3_status only by serializing
+		// every allocation with a mutex
+		bool memory_status = false;
+	};
+
+	struct SQLiteAllocatorStatistics
+	{
+		uint64_t allocations;
+		uint64_t frees;
+		// allocations too large for a size class go to malloc
+		uint64_t large_allocations;
+		// thread caches refilled from or flushed to the shared pool
+		uint64_t refills;
+		uint64_t flushes;
+
+		// usable size of live allocations as reported to sqlite. the
+		// peak is only tracked by sqlite3_status with memory_status
+		uint64_t bytes_in_use;
+		// chunks reserved by the pools. kept until the process exits
+		uint64_t bytes_reserved;
+	};
+
+	// replaces the allocator of sqlite with size class pools and thread
+	// local caches. fails if sqlite was already initialized
+	bool InstallSQLiteAllocator(const SQLiteAllocatorOptions& options = { });
+	bool IsSQLiteAllocatorInstalled();
+
+	// zero if the allocator is not installed
+	SQLiteAllocatorStatistics GetSQLiteAllocatorStatistics();
+
+	// gives sqlite a preallocated buffer for pages instances of the
+	// page cache, each big enough for page_size bytes and the page
+	// header of sqlite. has to be called before sqlite is initialized
+	bool ConfigureSQLitePageCache(int page_size, int pages);
+
+	// default lookaside memory of new connections, slots of slot_size
+	// bytes each. has to be called before sqlite is initialized
+	bool ConfigureSQLiteLookaside(int slot_size, int slots);
+	// lookaside memory of one connection. fails while the connection
+	// uses its lookaside memory
+	bool ConfigureSQLiteLookaside(SQLiteDatabase& database, int slot_size, int slots);
+}
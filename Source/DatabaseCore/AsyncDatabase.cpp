@@ -0,0 +1,127 @@
+#include "AsyncDatabase.h"
+
+#include <algorithm>
+#include <vector>
+
+namespace Database
+{
+	SQLiteAsyncDatabase::SQLiteAsyncDatabase(
+		std::string filename,
+		const SQLiteOpenOptions& options,
+		size_t max_pipelined_writes)
+		:
+		max_pipelined_writes(std::max<size_t>(max_pipelined_writes, 1))
+	{
+		std::promise<bool> open_promise;
+		std::future<bool> open_future = open_promise.get_future();
+
+		worker = std::thread(&SQLiteAsyncDatabase::run, this,
+			std::move(filename), options, std::move(open_promise));
+
+		opened = open_future.get();
+	}
+
+	SQLiteAsyncDatabase::~SQLiteAsyncDatabase()
+	{
+		queue.stop();
+		worker.join();
+	}
+
+	void SQLiteAsyncDatabase::push(std::unique_ptr<SQLiteAsyncTask> task)
+	{
+		if (!opened)
+		{
+			if (OnDatabaseCoreFailure)
+				OnDatabaseCoreFailure("tried to submit task to unopened async database");
+
+			task->cancel();
+			return;
+		}
+
+		queue.push(std::move(task));
+	}
+
+	void SQLiteAsyncDatabase::run(
+		std::string filename,
+		SQLiteOpenOptions options,
+		std::promise<bool> open_promise)
+	{
+		SQLiteDatabase database(std::move(filename), options);
+		open_promise.set_value((bool) database);
+
+		if (!database)
+		{
+			return;
+		}
+
+		std::unique_ptr<SQLiteAsyncTask> task;
+
+		// task can still hold the first task after a run of writes. the
+		// remaining tasks are drained before stopping
+		while (task || queue.pop(task))
+		{
+			if (task->is_write())
+			{
+				run_writes(database, task);
+			}
+			else
+			{
+				task->run(database);
+				task.reset();
+			}
+		}
+	}
+
+	void SQLiteAsyncDatabase::run_writes(SQLiteDatabase& database, std::unique_ptr<SQLiteAsyncTask>& task)
+	{
+		std::vector<std::unique_ptr<SQLiteAsyncTask>> writes;
+
+		// writes inside of a transaction opened by an earlier task join it
+		std::optional<SQLiteTransaction> transaction;
+
+		if (sqlite3_get_autocommit(database.get_database()) != 0)
+		{
+			transaction.emplace(&database, SQLiteTransactionMode::Immediate);
+		}
+
+		bool committed = true;
+
+		// takes writes until the queue is empty, the limit is reached or
+		// the next task is no write. a task that is no write stays in task
+		while (true)
+		{
+			task->run(database);
+			writes.push_back(std::move(task));
+
+			// some errors make sqlite roll back the whole transaction
+			if (transaction && *transaction && sqlite3_get_autocommit(database.get_database()) != 0)
+			{
+				committed = false;
+				break;
+			}
+
+			if (writes.size() >= max_pipelined_writes || !queue.try_pop(task))
+			{
+				break;
+			}
+
+			if (!task->is_write())
+			{
+				break;
+			}
+		}
+
+		// if begin failed every savepoint committed on its own
+		if (committed && transaction && *transaction)
+		{
+			committed = transaction->commit();
+		}
+
+		transaction.reset();
+
+		for (const std::unique_ptr<SQLiteAsyncTask>& write : writes)
+		{
+			write->complete(committed);
+		}
+	}
+}
@@ -0,0 +1,334 @@
+#pragma once
+
+#include "DatabaseCore.h"
+#include "MPSCQueue.h"
+
+#include <exception>
+#include <future>
+#include <memory>
+#include <thread>
+
+#if defined(DATABASECORE_COROUTINES) && defined(__cpp_impl_coroutine)
+#include <coroutine>
+#endif
+
+namespace Database
+{
+	// unit of work for the worker thread of SQLiteAsyncDatabase
+	class SQLiteAsyncTask
+	{
+	public:
+		virtual ~SQLiteAsyncTask() = default;
+
+		virtual void run(SQLiteDatabase& database) = 0;
+
+		// writes are grouped into one transaction and only complete after
+		// the transaction ended. committed is false if it was rolled back
+		virtual bool is_write() const
+		{
+			return false;
+		}
+
+		virtual void complete(bool)
+		{
+		}
+
+		// called instead of run if the database could not be opened.
+		// tasks holding a promise report a broken promise on destruction
+		virtual void cancel()
+		{
+		}
+	};
+
+	template <typename Result, typename Function>
+	class SQLiteAsyncFunctionTask
+		:
+		public SQLiteAsyncTask
+	{
+	public:
+		SQLiteAsyncFunctionTask(Function function)
+			:
+			function(std::move(function))
+		{
+		}
+
+		void run(SQLiteDatabase& database) override
+		{
+			try
+			{
+				if constexpr (std::is_void_v<Result>)
+				{
+					function(database);
+					promise.set_value();
+				}
+				else
+				{
+					promise.set_value(function(database));
+				}
+			}
+			catch (...)
+			{
+				promise.set_exception(std::current_exception());
+			}
+		}
+
+		std::future<Result> get_future()
+		{
+			return promise.get_future();
+		}
+
+	private:
+		Function function;
+		std::promise<Result> promise;
+	};
+
+	template <typename Function>
+	class SQLiteAsyncWriteTask
+		:
+		public SQLiteAsyncTask
+	{
+	public:
+		SQLiteAsyncWriteTask(Function function)
+			:
+			function(std::move(function))
+		{
+		}
+
+		// every write runs in its own savepoint, so a failed write does
+		// not roll back the others of its transaction
+		void run(SQLiteDatabase& database) override
+		{
+			SQLiteSavepoint savepoint(&database);
+
+			if (!savepoint)
+			{
+				return;
+			}
+
+			try
+			{
+				succeeded = function(database);
+			}
+			catch (...)
+			{
+				exception = std::current_exception();
+			}
+
+			if (succeeded)
+			{
+				succeeded = savepoint.commit();
+			}
+			else
+			{
+				savepoint.rollback();
+			}
+		}
+
+		bool is_write() const override
+		{
+			return true;
+		}
+
+		void complete(bool committed) override
+		{
+			if (exception)
+			{
+				promise.set_exception(exception);
+			}
+			else
+			{
+				promise.set_value(succeeded && committed);
+			}
+		}
+
+		std::future<bool> get_future()
+		{
+			return promise.get_future();
+		}
+
+	private:
+		Function function;
+		std::promise<bool> promise;
+
+		bool succeeded = false;
+		std::exception_ptr exception;
+	};
+
+	// owns a connection on a dedicated worker thread. tasks are submitted
+	// through a lock-free queue and run in submission order, so callers
+	// never block on the database. a task gets the connection as
+	// SQLiteDatabase& and must not keep statements of it beyond its call
+	class SQLiteAsyncDatabase
+	{
+	public:
+		// limits how many queued writes share one transaction
+		static constexpr size_t DefaultMaxPipelinedWrites = 256;
+
+		// blocks until the worker opened the database
+		SQLiteAsyncDatabase(std::string filename,
+			const SQLiteOpenOptions& options = { },
+			size_t max_pipelined_writes = DefaultMaxPipelinedWrites);
+
+		// runs all remaining tasks before returning
+		~SQLiteAsyncDatabase();
+
+		SQLiteAsyncDatabase(const SQLiteAsyncDatabase&) = delete;
+		SQLiteAsyncDatabase& operator=(const SQLiteAsyncDatabase&) = delete;
+
+		operator bool() const
+		{
+			return opened;
+		}
+
+		// runs function(SQLiteDatabase&) on the worker. the future holds
+		// its result or exception. if the database could not be opened
+		// the future reports a broken promise
+		template <typename Function>
+		auto submit(Function function)
+			-> std::future<std::invoke_result_t<Function&, SQLiteDatabase&>>
+		{
+			typedef std::invoke_result_t<Function&, SQLiteDatabase&> Result;
+
+			auto task = std::make_unique<SQLiteAsyncFunctionTask<Result, Function>>(std::move(function));
+			auto future = task->get_future();
+
+			push(std::move(task));
+			return future;
+		}
+
+		// runs bool function(SQLiteDatabase&) on the worker. writes queued
+		// back to back share one transaction, each in its own savepoint.
+		// the future is true if function returned true and the
+		// transaction was committed
+		template <typename Function>
+		std::future<bool> submit_write(Function function)
+		{
+			auto task = std::make_unique<SQLiteAsyncWriteTask<Function>>(std::move(function));
+			auto future = task->get_future();
+
+			push(std::move(task));
+			return future;
+		}
+
+#if defined(DATABASECORE_COROUTINES) && defined(__cpp_impl_coroutine)
+		template <typename Function>
+		class Awaitable;
+
+		// co_await database.async(function). the coroutine resumes on the
+		// worker thread and should hand itself back to its own executor
+		// before doing more than light work
+		template <typename Function>
+		Awaitable<Function> async(Function function)
+		{
+			return Awaitable<Function>(this, std::move(function));
+		}
+#endif
+
+	private:
+		void push(std::unique_ptr<SQLiteAsyncTask> task);
+
+		void run(std::string filename, SQLiteOpenOptions options, std::promise<bool> open_promise);
+		void run_writes(SQLiteDatabase& database, std::unique_ptr<SQLiteAsyncTask>& task);
+
+		size_t max_pipelined_writes;
+		bool opened = false;
+
+		SQLiteWorkQueue<std::unique_ptr<SQLiteAsyncTask>> queue;
+
+		std::thread worker;
+	};
+
+#if defined(DATABASECORE_COROUTINES) && defined(__cpp_impl_coroutine)
+	template <typename Function>
+	class SQLiteAsyncDatabase::Awaitable
+	{
+		typedef std::invoke_result_t<Function&, SQLiteDatabase&> Result;
+
+		class Task
+			:
+			public SQLiteAsyncTask
+		{
+		public:
+			Task(Awaitable* awaitable, std::coroutine_handle<> handle)
+				:
+				awaitable(awaitable),
+				handle(handle)
+			{
+			}
+
+			void run(SQLiteDatabase& database) override
+			{
+				try
+				{
+					if constexpr (std::is_void_v<Result>)
+					{
+						awaitable->function(database);
+					}
+					else
+					{
+						awaitable->result.emplace(awaitable->function(database));
+					}
+				}
+				catch (...)
+				{
+					awaitable->exception = std::current_exception();
+				}
+
+				handle.resume();
+			}
+
+			void cancel() override
+			{
+				awaitable->exception = std::make_exception_ptr(
+					std::future_error(std::future_errc::broken_promise));
+
+				handle.resume();
+			}
+
+		private:
+			Awaitable* awaitable;
+			std::coroutine_handle<> handle;
+		};
+
+	public:
+		Awaitable(SQLiteAsyncDatabase* database, Function function)
+			:
+			database(database),
+			function(std::move(function))
+		{
+		}
+
+		bool await_ready() const
+		{
+			return false;
+		}
+
+		void await_suspend(std::coroutine_handle<> handle)
+		{
+			database->push(std::make_unique<Task>(this, handle));
+		}
+
+		Result await_resume()
+		{
+			if (exception)
+			{
+				std::rethrow_exception(exception);
+			}
+
+			if constexpr (!std::is_void_v<Result>)
+			{
+				return std::move(*result);
+			}
+		}
+
+	private:
+		SQLiteAsyncDatabase* database;
+		Function function;
+
+		std::conditional_t<std::is_void_v<Result>, bool, std::optional<Result>> result{ };
+		std::exception_ptr exception;
+	};
+#endif
+
+	using AsyncDatabase = SQLiteAsyncDatabase;
+}
@@ -0,0 +1,195 @@
+#include "Backup.h"
+
+#include <thread>
+
+namespace Database
+{
+	SQLiteBackup::SQLiteBackup(
+		SQLiteDatabase* destination,
+		SQLiteDatabase* source,
+		const std::string& destination_schema,
+		const std::string& source_schema)
+		:
+		destination(destination)
+	{
+		backup = sqlite3_backup_init(
+			destination->get_database(), destination_schema.c_str(),
+			source->get_database(), source_schema.c_str());
+
+		// errors of init are stored in the destination connection
+		if (backup == NULL)
+		{
+			failed = true;
+
+			EnsureSQLiteStatusCode(
+				destination->last_error_code(),
+				"failed to start backup");
+		}
+	}
+
+	bool SQLiteBackup::step(int pages)
+	{
+		if (backup == NULL)
+		{
+			if (OnDatabaseCoreFailure)
+				OnDatabaseCoreFailure("tried to step finished or failed backup");
+
+			return false;
+		}
+
+		const int result = sqlite3_backup_step(backup, pages);
+		locked = false;
+
+		switch (result)
+		{
+		case SQLITE_DONE:
+			done = true;
+
+			return true;
+		case SQLITE_BUSY:
+		case SQLITE_LOCKED:
+			locked = true;
+
+			return true;
+		case SQLITE_OK:
+			return true;
+		}
+
+		// the backup can not continue, finish reports the error
+		failed = true;
+		finish();
+
+		return false;
+	}
+
+	bool SQLiteBackup::run(const SQLiteBackupOptions& options)
+	{
+		int pages = options.pages_per_step;
+		int restarts = 0;
+		int remaining = -1;
+
+		std::chrono::steady_clock::time_point locked_since;
+		bool waiting = false;
+
+		while (!done)
+		{
+			if (!step(pages))
+			{
+				return false;
+			}
+
+			if (!locked)
+			{
+				waiting = false;
+			}
+			else if (!waiting)
+			{
+				locked_since = std::chrono::steady_clock::now();
+				waiting = true;
+			}
+			else if (std::chrono::steady_clock::now() - locked_since >= options.lock_timeout)
+			{
+				if (OnDatabaseCoreFailure)
+					OnDatabaseCoreFailure("backup timed out waiting for lock");
+
+				failed = true;
+				finish();
+
+				return false;
+			}
+
+			const SQLiteBackupProgress progress = get_progress();
+
+			// more pages remaining than before means the copy restarted
+			if (remaining >= 0 && progress.remaining > remaining
+				&& ++restarts >= options.max_restarts)
+			{
+				pages = -1;
+			}
+
+			remaining = progress.remaining;
+
+			if (options.on_progress)
+			{
+				options.on_progress(progress);
+			}
+
+			if (!done && options.sleep.count() > 0)
+			{
+				std::this_thread::sleep_for(options.sleep);
+			}
+		}
+
+		return finish();
+	}
+
+	bool SQLiteBackup::finish()
+	{
+		if (backup == NULL)
+		{
+			return !failed;
+		}
+
+		// finish returns the error of the last failed step
+		const bool finished = EnsureSQLiteStatusCode(
+			sqlite3_backup_finish(backup),
+			"failed to finish backup");
+		backup = NULL;
+
+		failed = failed || !finished;
+		return !failed;
+	}
+
+	SQLiteBackupProgress SQLiteBackup::get_progress() const
+	{
+		if (backup == NULL)
+		{
+			return SQLiteBackupProgress{ 0, 0 };
+		}
+
+		return SQLiteBackupProgress
+		{
+			sqlite3_backup_remaining(backup),
+			sqlite3_backup_pagecount(backup)
+		};
+	}
+
+	bool LoadSQLiteDatabase(SQLiteDatabase& database, const std::string& filename,
+		const SQLiteBackupOptions& options)
+	{
+		SQLiteOpenOptions open_options;
+		open_options.read_only = true;
+
+		SQLiteDatabase source(filename, open_options);
+
+		if (!source)
+		{
+			return false;
+		}
+
+		SQLiteInt page_size = 0;
+
+		if (!SQLiteStatement<SQLiteInt>(&source, "PRAGMA page_size").execute(page_size)
+			|| !SQLiteStatement<>(&database, "PRAGMA page_size = " + std::to_string(page_size)).execute())
+		{
+			return false;
+		}
+
+		SQLiteBackup backup(&database, &source);
+		return backup && backup.run(options);
+	}
+
+	bool SaveSQLiteDatabase(SQLiteDatabase& database, const std::string& filename,
+		const SQLiteBackupOptions& options)
+	{
+		SQLiteDatabase destination(filename);
+
+		if (!destination)
+		{
+			return false;
+		}
+
+		SQLiteBackup backup(&destination, &database);
+		return backup && backup.run(options);
+	}
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include "DatabaseCore.h"
+
+#include <chrono>
+#include <functional>
+
+namespace Database
+{
+	struct SQLiteBackupProgress
+	{
+		int remaining;
+		int total;
+	};
+
+	struct SQLiteBackupOptions
+	{
+		// pages copied per step while holding a read lock on the source.
+		// a negative number copies everything in one step
+		int pages_per_step = 128;
+		// pause between steps, so writers of the source are not stalled.
+		// also the wait before retrying a step that found it locked
+		std::chrono::milliseconds sleep{ 5 };
+		// a source written by other connections between steps restarts
+		// the copy and might never let it finish. after this many
+		// restarts the rest is copied in one step
+		int max_restarts = 8;
+		// how long steps may keep finding the source or destination
+		// locked before run gives up and fails
+		std::chrono::milliseconds lock_timeout{ 5000 };
+		// called after every step
+		std::function<void(const SQLiteBackupProgress&)> on_progress;
+	};
+
+	// copies a database page by page into another database, while the
+	// source stays usable. a write to the source through another
+	// connection restarts the copy with the next step, a write through
+	// the source connection itself is copied along. the destination
+	// must not be used until the backup finished
+	class SQLiteBackup
+	{
+	public:
+		SQLiteBackup(SQLiteDatabase* destination,
+			SQLiteDatabase* source,
+			const std::string& destination_schema = "main",
+			const std::string& source_schema = "main");
+
+		~SQLiteBackup()
+		{
+			if (backup)
+				finish();
+		}
+
+		SQLiteBackup(const SQLiteBackup&) = delete;
+		SQLiteBackup& operator=(const SQLiteBackup&) = delete;
+
+		// false if the backup could not be started or failed
+		operator bool() const
+		{
+			return !failed;
+		}
+
+		// copies up to pages pages, all if negative. a locked source or
+		// destination is no failure, the step has to be repeated later
+		bool step(int pages);
+
+		// steps until done with options. returns false if a step failed,
+		// the lock timeout ran out or the backup was already finished
+		bool run(const SQLiteBackupOptions& options = { });
+
+		// releases the backup. false if the backup failed at any point
+		bool finish();
+
+		bool is_done() const
+		{
+			return done;
+		}
+
+		// true if the last step could not copy because of a lock
+		bool is_locked() const
+		{
+			return locked;
+		}
+
+		// both are only updated by step
+		SQLiteBackupProgress get_progress() const;
+
+	private:
+		SQLiteDatabase* destination;
+		sqlite3_backup* backup;
+
+		bool done = false;
+		bool failed = false;
+		bool locked = false;
+	};
+
+	// copies the database file at filename into database, which should
+	// be a fresh connection, usually of ":memory:". the page size of
+	// database is adjusted to the file first, as in-memory databases
+	// can not change it during a backup
+	bool LoadSQLiteDatabase(SQLiteDatabase& database, const std::string& filename,
+		const SQLiteBackupOptions& options = { -1 });
+
+	// writes a snapshot of database to the file at filename, which is
+	// replaced
+	bool SaveSQLiteDatabase(SQLiteDatabase& database, const std::string& filename,
+		const SQLiteBackupOptions& options = { });
+
+	using Backup = SQLiteBackup;
+}
@@ -0,0 +1,163 @@
+#include "BlobStream.h"
+
+#include <algorithm>
+
+namespace Database
+{
+	SQLiteBlobStream::SQLiteBlobStream(
+		SQLiteDatabase* database,
+		std::string table,
+		std::string column,
+		SQLiteInt row,
+		bool writable,
+		std::string schema)
+		:
+		database(database),
+		schema(std::move(schema)),
+		table(std::move(table)),
+		column(std::move(column)),
+		writable(writable),
+		row(row)
+	{
+		open();
+	}
+
+	bool SQLiteBlobStream::reopen(SQLiteInt row)
+	{
+		this->row = row;
+		position = 0;
+		blob_size = 0;
+
+		if (blob)
+		{
+			const int result = sqlite3_blob_reopen(blob, row);
+
+			// an aborted handle, for example after its row was changed,
+			// can only be replaced
+			if (result != SQLITE_ABORT)
+			{
+				failed = !EnsureSQLiteStatusCode(result, "failed to reopen blob");
+
+				if (!failed)
+				{
+					blob_size = sqlite3_blob_bytes(blob);
+				}
+
+				return !failed;
+			}
+
+			sqlite3_blob_close(blob);
+			blob = NULL;
+		}
+
+		return open();
+	}
+
+	size_t SQLiteBlobStream::read(void* data, size_t size)
+	{
+		if (!*this)
+		{
+			if (OnDatabaseCoreFailure)
+				OnDatabaseCoreFailure("tried to read from invalid blob stream");
+
+			return 0;
+		}
+
+		size = std::min(size, blob_size - position);
+
+		if (size == 0)
+		{
+			return 0;
+		}
+
+		if (!EnsureSQLiteStatusCode(
+				sqlite3_blob_read(blob, data, (int) size, (int) position),
+				"failed to read blob"))
+		{
+			failed = true;
+			return 0;
+		}
+
+		position += size;
+		return size;
+	}
+
+	size_t SQLiteBlobStream::read(SQLiteBlob& chunk, size_t size)
+	{
+		const size_t offset = chunk.size();
+		chunk.resize(offset + std::min(size, blob_size - position));
+
+		const size_t count = read(chunk.data() + offset, chunk.size() - offset);
+		chunk.resize(offset + count);
+
+		return count;
+	}
+
+	bool SQLiteBlobStream::write(const void* data, size_t size)
+	{
+		if (!*this)
+		{
+			if (OnDatabaseCoreFailure)
+				OnDatabaseCoreFailure("tried to write to invalid blob stream");
+
+			return false;
+		}
+
+		if (size > blob_size - position)
+		{
+			if (OnDatabaseCoreFailure)
+				OnDatabaseCoreFailure("tried to write past the end of blob");
+
+			return false;
+		}
+
+		if (size == 0)
+		{
+			return true;
+		}
+
+		if (!EnsureSQLiteStatusCode(
+				sqlite3_blob_write(blob, data, (int) size, (int) position),
+				"failed to write blob"))
+		{
+			failed = true;
+			return false;
+		}
+
+		position += size;
+		return true;
+	}
+
+	bool SQLiteBlobStream::open()
+	{
+		failed = false;
+
+		// blob stays null if opening failed
+		if (!EnsureSQLiteStatusCode(
+				sqlite3_blob_open(
+					database->get_database(),
+					schema.c_str(), table.c_str(), column.c_str(),
+					row, writable ? 1 : 0, &blob),
+				"failed to open blob"))
+		{
+			return false;
+		}
+
+		blob_size = sqlite3_blob_bytes(blob);
+		return true;
+	}
+
+	bool SQLiteBlobStream::seek(size_t position)
+	{
+		if (position > blob_size)
+		{
+			if (OnDatabaseCoreFailure)
+				OnDatabaseCoreFailure("tried to seek past the end of blob");
+
+			return false;
+		}
+
+		this->position = position;
+		return true;
+	}
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include "DatabaseCore.h"
+
+namespace Database
+{
+	// reads and writes one blob in chunks without loading it as a whole.
+	// a blob can not change its size through the stream, new blobs are
+	// inserted as SQLiteZeroBlob and filled afterwards. the stream is
+	// invalidated if its row is changed or deleted by another statement
+	// and has to be reopened
+	class SQLiteBlobStream
+	{
+	public:
+		SQLiteBlobStream(SQLiteDatabase* database,
+			std::string table,
+			std::string column,
+			SQLiteInt row,
+			bool writable = false,
+			std::string schema = "main");
+
+		~SQLiteBlobStream()
+		{
+			// null is a noop
+			sqlite3_blob_close(blob);
+		}
+
+		SQLiteBlobStream(const SQLiteBlobStream&) = delete;
+		SQLiteBlobStream& operator=(const SQLiteBlobStream&) = delete;
+
+		// false if opening, reopening or the last read or write failed
+		operator bool() const
+		{
+			return blob != NULL && !failed;
+		}
+
+		// moves the stream to the blob of another row of the same table
+		// and column, which is cheaper than opening a new stream. also
+		// recovers a stream that failed
+		bool reopen(SQLiteInt row);
+
+		// reads up to size bytes and advances the position. returns the
+		// number of bytes read, less than size only at the end or after
+		// a failure
+		size_t read(void* data, size_t size);
+		// appends up to size bytes to chunk
+		size_t read(SQLiteBlob& chunk, size_t size);
+
+		// writes all size bytes or nothing and advances the position
+		bool write(const void* data, size_t size);
+		bool write(SQLiteBlobView chunk)
+		{
+			return write(chunk.data(), chunk.size());
+		}
+
+		// positions past the end are invalid
+		bool seek(size_t position);
+
+		size_t tell() const
+		{
+			return position;
+		}
+
+		size_t size() const
+		{
+			return blob_size;
+		}
+
+		SQLiteInt get_row() const
+		{
+			return row;
+		}
+
+		sqlite3_blob* get_blob() const
+		{
+			return blob;
+		}
+
+	private:
+		SQLiteDatabase* database;
+		sqlite3_blob* blob = NULL;
+
+		std::string schema;
+		std::string table;
+		std::string column;
+		bool writable;
+
+		SQLiteInt row;
+		size_t position = 0;
+		size_t blob_size = 0;
+
+		bool failed = false;
+
+		bool open();
+	};
+
+	using BlobStream = SQLiteBlobStream;
+}
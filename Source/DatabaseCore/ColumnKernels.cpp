@@ -0,0 +1,1034 @@
+#include "ColumnKernels.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <limits>
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define DATABASECORE_KERNELS_X64
+
+#include <immintrin.h>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+
+// msvc allows intrinsics of every instruction set without /arch
+#define DATABASECORE_TARGET_AVX2
+#define DATABASECORE_TARGET_AVX512
+#else
+#include <cpuid.h>
+
+#define DATABASECORE_TARGET_AVX2 __attribute__((target("avx2")))
+#define DATABASECORE_TARGET_AVX512 __attribute__((target("avx512f,popcnt")))
+#endif
+#endif
+
+namespace Database
+{
+	namespace
+	{
+#ifdef DATABASECORE_KERNELS_X64
+		void CPUID(int leaf, int subleaf, int registers[4])
+		{
+#if defined(_MSC_VER)
+			__cpuidex(registers, leaf, subleaf);
+#else
+			unsigned int eax, ebx, ecx, edx;
+			__cpuid_count(leaf, subleaf, eax, ebx, ecx, edx);
+
+			registers[0] = (int) eax;
+			registers[1] = (int) ebx;
+			registers[2] = (int) ecx;
+			registers[3] = (int) edx;
+#endif
+		}
+
+		unsigned long long XGETBV()
+		{
+#if defined(_MSC_VER)
+			return _xgetbv(0);
+#else
+			unsigned int eax, edx;
+			__asm__ volatile ("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+			return ((unsigned long long) edx << 32) | eax;
+#endif
+		}
+
+		SQLiteKernelLevel DetectKernelLevel()
+		{
+			int registers[4];
+
+			CPUID(0, 0, registers);
+			const int maximum_leaf = registers[0];
+
+			if (maximum_leaf < 7)
+			{
+				return SQLiteKernelLevel::Scalar;
+			}
+
+			CPUID(1, 0, registers);
+
+			// the os has to save the ymm and zmm registers on context switches
+			const bool popcnt = registers[2] & (1 << 23);
+			const bool osxsave = registers[2] & (1 << 27);
+			const bool avx = registers[2] & (1 << 28);
+
+			if (!popcnt || !osxsave || !avx)
+			{
+				return SQLiteKernelLevel::Scalar;
+			}
+
+			const unsigned long long xcr0 = XGETBV();
+
+			CPUID(7, 0, registers);
+
+			const bool avx2 = registers[1] & (1 << 5);
+			const bool avx512f = registers[1] & (1 << 16);
+
+			if (avx512f && (xcr0 & 0xE6) == 0xE6)
+			{
+				return SQLiteKernelLevel::AVX512;
+			}
+
+			if (avx2 && (xcr0 & 0x06) == 0x06)
+			{
+				return SQLiteKernelLevel::AVX2;
+			}
+
+			return SQLiteKernelLevel::Scalar;
+		}
+#else
+		SQLiteKernelLevel DetectKernelLevel()
+		{
+			return SQLiteKernelLevel::Scalar;
+		}
+#endif
+
+		std::atomic<SQLiteKernelLevel>& GetKernelLevelStorage()
+		{
+			static std::atomic<SQLiteKernelLevel> level{ GetSupportedKernelLevel() };
+			return level;
+		}
+
+		template <typename T>
+		bool Compare(SQLiteCompare compare, T value, T operand)
+		{
+			switch (compare)
+			{
+			case SQLiteCompare::Less:
+				return value < operand;
+			case SQLiteCompare::LessEqual:
+				return value <= operand;
+			case SQLiteCompare::Greater:
+				return value > operand;
+			case SQLiteCompare::GreaterEqual:
+				return value >= operand;
+			case SQLiteCompare::Equal:
+				return value == operand;
+			case SQLiteCompare::NotEqual:
+				return value != operand;
+			}
+
+			return false;
+		}
+
+		// scalar kernels. also handle the tails of the vectorized kernels
+
+		SQLiteInt SumScalar(const SQLiteInt* data, size_t size)
+		{
+			// unsigned to wrap around instead of overflowing
+			uint64_t sum = 0;
+
+			for (size_t i = 0; i < size; ++i)
+			{
+				sum += (uint64_t) data[i];
+			}
+
+			return (SQLiteInt) sum;
+		}
+
+		SQLiteReal SumScalar(const SQLiteReal* data, size_t size)
+		{
+			SQLiteReal sum = 0;
+
+			for (size_t i = 0; i < size; ++i)
+			{
+				sum += data[i];
+			}
+
+			return sum;
+		}
+
+		template <typename T>
+		void MinMaxScalar(const T* data, size_t size, T& min, T& max)
+		{
+			for (size_t i = 0; i < size; ++i)
+			{
+				min = std::min(min, data[i]);
+				max = std::max(max, data[i]);
+			}
+		}
+
+		template <typename T>
+		size_t FilterScalar(const T* data, size_t begin, size_t size,
+			SQLiteCompare compare, T operand,
+			uint32_t* selection)
+		{
+			size_t count = 0;
+
+			// branchless, the result of the comparison decides whether
+			// the next write overrides this index
+			for (size_t i = begin; i < size; ++i)
+			{
+				selection[count] = (uint32_t) i;
+				count += Compare(compare, data[i], operand);
+			}
+
+			return count;
+		}
+
+		// distance of value to min as double. integers subtract first,
+		// which is exact as long as the range of the column fits
+		SQLiteReal BinOffset(SQLiteInt value, SQLiteInt min)
+		{
+			return (SQLiteReal) ((uint64_t) value - (uint64_t) min);
+		}
+
+		SQLiteReal BinOffset(SQLiteReal value, SQLiteReal min)
+		{
+			return value - min;
+		}
+
+		// writes the bin of every value to bins. values outside of
+		// [min, max] get last + 1, which is dropped afterwards
+		template <typename T>
+		void BinScalar(const T* data, size_t begin, size_t size,
+			T min, T max, SQLiteReal scale, uint32_t last,
+			uint32_t* bins)
+		{
+			for (size_t i = begin; i < size; ++i)
+			{
+				// the negated comparison also drops nan
+				bins[i] = !(data[i] >= min && data[i] <= max)
+					? last + 1
+					: (uint32_t) std::min(BinOffset(data[i], min) * scale, (SQLiteReal) last);
+			}
+		}
+
+#ifdef DATABASECORE_KERNELS_X64
+		// for every four bit mask the lanes of its set bits, packed to the
+		// front, and their number
+		struct SelectionTable
+		{
+			alignas(16) uint32_t lanes[16][4];
+			uint32_t counts[16];
+		};
+
+		constexpr SelectionTable MakeSelectionTable()
+		{
+			SelectionTable table{ };
+
+			for (uint32_t mask = 0; mask < 16; ++mask)
+			{
+				for (uint32_t lane = 0; lane < 4; ++lane)
+				{
+					if (mask & (1 << lane))
+					{
+						table.lanes[mask][table.counts[mask]++] = lane;
+					}
+				}
+			}
+
+			return table;
+		}
+
+		constexpr SelectionTable Selection = MakeSelectionTable();
+
+		// always writes four indices, the ones past the selected lanes are
+		// overridden by the next call
+		DATABASECORE_TARGET_AVX2
+		size_t WriteSelectionAVX2(unsigned int mask, size_t index, uint32_t* selection)
+		{
+			const __m128i lanes = _mm_load_si128((const __m128i*) Selection.lanes[mask]);
+			_mm_storeu_si128((__m128i*) selection, _mm_add_epi32(lanes, _mm_set1_epi32((int) index)));
+
+			return Selection.counts[mask];
+		}
+
+		DATABASECORE_TARGET_AVX2
+		SQLiteInt SumAVX2(const SQLiteInt* data, size_t size)
+		{
+			__m256i sum0 = _mm256_setzero_si256();
+			__m256i sum1 = _mm256_setzero_si256();
+
+			size_t i = 0;
+
+			for (; i + 8 <= size; i += 8)
+			{
+				sum0 = _mm256_add_epi64(sum0, _mm256_loadu_si256((const __m256i*) (data + i)));
+				sum1 = _mm256_add_epi64(sum1, _mm256_loadu_si256((const __m256i*) (data + i + 4)));
+			}
+
+			alignas(32) uint64_t lanes[4];
+			_mm256_store_si256((__m256i*) lanes, _mm256_add_epi64(sum0, sum1));
+
+			return (SQLiteInt) (lanes[0] + lanes[1] + lanes[2] + lanes[3]
+				+ (uint64_t) SumScalar(data + i, size - i));
+		}
+
+		DATABASECORE_TARGET_AVX2
+		SQLiteReal SumAVX2(const SQLiteReal* data, size_t size)
+		{
+			// independent accumulators hide the latency of the addition
+			__m256d sum0 = _mm256_setzero_pd();
+			__m256d sum1 = _mm256_setzero_pd();
+			__m256d sum2 = _mm256_setzero_pd();
+			__m256d sum3 = _mm256_setzero_pd();
+
+			size_t i = 0;
+
+			for (; i + 16 <= size; i += 16)
+			{
+				sum0 = _mm256_add_pd(sum0, _mm256_loadu_pd(data + i));
+				sum1 = _mm256_add_pd(sum1, _mm256_loadu_pd(data + i + 4));
+				sum2 = _mm256_add_pd(sum2, _mm256_loadu_pd(data + i + 8));
+				sum3 = _mm256_add_pd(sum3, _mm256_loadu_pd(data + i + 12));
+			}
+
+			alignas(32) double lanes[4];
+			_mm256_store_pd(lanes, _mm256_add_pd(
+				_mm256_add_pd(sum0, sum1),
+				_mm256_add_pd(sum2, sum3)));
+
+			return lanes[0] + lanes[1] + lanes[2] + lanes[3] + SumScalar(data + i, size - i);
+		}
+
+		DATABASECORE_TARGET_AVX2
+		void MinMaxAVX2(const SQLiteInt* data, size_t size, SQLiteInt& min, SQLiteInt& max)
+		{
+			__m256i minimum = _mm256_set1_epi64x(min);
+			__m256i maximum = _mm256_set1_epi64x(max);
+
+			size_t i = 0;
+
+			// avx2 has no 64 bit min and max, blend with comparisons instead
+			for (; i + 4 <= size; i += 4)
+			{
+				const __m256i value = _mm256_loadu_si256((const __m256i*) (data + i));
+
+				minimum = _mm256_blendv_epi8(minimum, value, _mm256_cmpgt_epi64(minimum, value));
+				maximum = _mm256_blendv_epi8(maximum, value, _mm256_cmpgt_epi64(value, maximum));
+			}
+
+			alignas(32) SQLiteInt minimum_lanes[4];
+			alignas(32) SQLiteInt maximum_lanes[4];
+
+			_mm256_store_si256((__m256i*) minimum_lanes, minimum);
+			_mm256_store_si256((__m256i*) maximum_lanes, maximum);
+
+			MinMaxScalar(minimum_lanes, 4, min, max);
+			MinMaxScalar(maximum_lanes, 4, min, max);
+			MinMaxScalar(data + i, size - i, min, max);
+		}
+
+		DATABASECORE_TARGET_AVX2
+		void MinMaxAVX2(const SQLiteReal* data, size_t size, SQLiteReal& min, SQLiteReal& max)
+		{
+			__m256d minimum = _mm256_set1_pd(min);
+			__m256d maximum = _mm256_set1_pd(max);
+
+			size_t i = 0;
+
+			for (; i + 4 <= size; i += 4)
+			{
+				const __m256d value = _mm256_loadu_pd(data + i);
+
+				minimum = _mm256_min_pd(minimum, value);
+				maximum = _mm256_max_pd(maximum, value);
+			}
+
+			alignas(32) SQLiteReal minimum_lanes[4];
+			alignas(32) SQLiteReal maximum_lanes[4];
+
+			_mm256_store_pd(minimum_lanes, minimum);
+			_mm256_store_pd(maximum_lanes, maximum);
+
+			MinMaxScalar(minimum_lanes, 4, min, max);
+			MinMaxScalar(maximum_lanes, 4, min, max);
+			MinMaxScalar(data + i, size - i, min, max);
+		}
+
+		DATABASECORE_TARGET_AVX2
+		size_t FilterAVX2(const SQLiteInt* data, size_t size,
+			SQLiteCompare compare, SQLiteInt operand,
+			uint32_t* selection)
+		{
+			const __m256i operand_lanes = _mm256_set1_epi64x(operand);
+
+			// only greater and equal exist, the others are derived by
+			// swapping the operands or inverting the mask
+			const bool swap = compare == SQLiteCompare::Less
+				|| compare == SQLiteCompare::GreaterEqual;
+			const bool equal = compare == SQLiteCompare::Equal
+				|| compare == SQLiteCompare::NotEqual;
+			const unsigned int invert = compare == SQLiteCompare::LessEqual
+				|| compare == SQLiteCompare::GreaterEqual
+				|| compare == SQLiteCompare::NotEqual ? 0xF : 0x0;
+
+			size_t count = 0;
+			size_t i = 0;
+
+			for (; i + 4 <= size; i += 4)
+			{
+				const __m256i value = _mm256_loadu_si256((const __m256i*) (data + i));
+				const __m256i result = equal
+					? _mm256_cmpeq_epi64(value, operand_lanes)
+					: swap
+						? _mm256_cmpgt_epi64(operand_lanes, value)
+						: _mm256_cmpgt_epi64(value, operand_lanes);
+
+				const unsigned int mask = (unsigned int) _mm256_movemask_pd(_mm256_castsi256_pd(result)) ^ invert;
+				count += WriteSelectionAVX2(mask, i, selection + count);
+			}
+
+			return count + FilterScalar(data, i, size, compare, operand, selection + count);
+		}
+
+		template <int Predicate>
+		DATABASECORE_TARGET_AVX2
+		size_t FilterAVX2(const SQLiteReal* data, size_t size,
+			SQLiteReal operand,
+			uint32_t* selection)
+		{
+			const __m256d operand_lanes = _mm256_set1_pd(operand);
+
+			size_t count = 0;
+			size_t i = 0;
+
+			for (; i + 4 <= size; i += 4)
+			{
+				const __m256d result = _mm256_cmp_pd(_mm256_loadu_pd(data + i), operand_lanes, Predicate);
+				count += WriteSelectionAVX2((unsigned int) _mm256_movemask_pd(result), i, selection + count);
+			}
+
+			return count;
+		}
+
+		DATABASECORE_TARGET_AVX2
+		size_t FilterAVX2(const SQLiteReal* data, size_t size,
+			SQLiteCompare compare, SQLiteReal operand,
+			uint32_t* selection)
+		{
+			size_t count = 0;
+
+			// the predicate of _mm256_cmp_pd has to be a constant
+			switch (compare)
+			{
+			case SQLiteCompare::Less:
+				count = FilterAVX2<_CMP_LT_OQ>(data, size, operand, selection);
+				break;
+			case SQLiteCompare::LessEqual:
+				count = FilterAVX2<_CMP_LE_OQ>(data, size, operand, selection);
+				break;
+			case SQLiteCompare::Greater:
+				count = FilterAVX2<_CMP_GT_OQ>(data, size, operand, selection);
+				break;
+			case SQLiteCompare::GreaterEqual:
+				count = FilterAVX2<_CMP_GE_OQ>(data, size, operand, selection);
+				break;
+			case SQLiteCompare::Equal:
+				count = FilterAVX2<_CMP_EQ_OQ>(data, size, operand, selection);
+				break;
+			case SQLiteCompare::NotEqual:
+				count = FilterAVX2<_CMP_NEQ_UQ>(data, size, operand, selection);
+				break;
+			}
+
+			const size_t tail = size - size % 4;
+			return count + FilterScalar(data, tail, size, compare, operand, selection + count);
+		}
+
+		// the integer kernels convert the offset to min with the bits
+		// of 2^52, so the range of the column has to be below 2^52
+		constexpr uint64_t BinMagic = 0x4330000000000000;
+		constexpr SQLiteReal BinMagicValue = 4503599627370496.0;
+
+		DATABASECORE_TARGET_AVX2
+		void BinAVX2(const SQLiteInt* data, size_t size,
+			SQLiteInt min, SQLiteInt max, SQLiteReal scale, uint32_t last,
+			uint32_t* bins)
+		{
+			const __m256i minimum = _mm256_set1_epi64x(min);
+			const __m256i maximum = _mm256_set1_epi64x(max);
+			const __m256i magic = _mm256_set1_epi64x((long long) BinMagic);
+			const __m256d magic_value = _mm256_set1_pd(BinMagicValue);
+			const __m256d scale_lanes = _mm256_set1_pd(scale);
+			const __m256d last_lanes = _mm256_set1_pd(last);
+			const __m256d drop_lanes = _mm256_set1_pd((SQLiteReal) last + 1);
+
+			size_t i = 0;
+
+			for (; i + 4 <= size; i += 4)
+			{
+				const __m256i value = _mm256_loadu_si256((const __m256i*) (data + i));
+				const __m256i outside = _mm256_or_si256(
+					_mm256_cmpgt_epi64(minimum, value),
+					_mm256_cmpgt_epi64(value, maximum));
+
+				const __m256d offset = _mm256_sub_pd(
+					_mm256_castsi256_pd(_mm256_or_si256(_mm256_sub_epi64(value, minimum), magic)),
+					magic_value);
+				const __m256d bin = _mm256_blendv_pd(
+					_mm256_min_pd(_mm256_mul_pd(offset, scale_lanes), last_lanes),
+					drop_lanes,
+					_mm256_castsi256_pd(outside));
+
+				_mm_storeu_si128((__m128i*) (bins + i), _mm256_cvttpd_epi32(bin));
+			}
+
+			BinScalar(data, i, size, min, max, scale, last, bins);
+		}
+
+		DATABASECORE_TARGET_AVX2
+		void BinAVX2(const SQLiteReal* data, size_t size,
+			SQLiteReal min, SQLiteReal max, SQLiteReal scale, uint32_t last,
+			uint32_t* bins)
+		{
+			const __m256d minimum = _mm256_set1_pd(min);
+			const __m256d maximum = _mm256_set1_pd(max);
+			const __m256d scale_lanes = _mm256_set1_pd(scale);
+			const __m256d last_lanes = _mm256_set1_pd(last);
+			const __m256d drop_lanes = _mm256_set1_pd((SQLiteReal) last + 1);
+
+			size_t i = 0;
+
+			for (; i + 4 <= size; i += 4)
+			{
+				const __m256d value = _mm256_loadu_pd(data + i);
+
+				// ordered comparisons are false for nan
+				const __m256d inside = _mm256_and_pd(
+					_mm256_cmp_pd(value, minimum, _CMP_GE_OQ),
+					_mm256_cmp_pd(value, maximum, _CMP_LE_OQ));
+				const __m256d bin = _mm256_blendv_pd(
+					drop_lanes,
+					_mm256_min_pd(_mm256_mul_pd(_mm256_sub_pd(value, minimum), scale_lanes), last_lanes),
+					inside);
+
+				_mm_storeu_si128((__m128i*) (bins + i), _mm256_cvttpd_epi32(bin));
+			}
+
+			BinScalar(data, i, size, min, max, scale, last, bins);
+		}
+
+		DATABASECORE_TARGET_AVX512
+		SQLiteInt SumAVX512(const SQLiteInt* data, size_t size)
+		{
+			__m512i sum0 = _mm512_setzero_si512();
+			__m512i sum1 = _mm512_setzero_si512();
+
+			size_t i = 0;
+
+			for (; i + 16 <= size; i += 16)
+			{
+				sum0 = _mm512_add_epi64(sum0, _mm512_loadu_si512(data + i));
+				sum1 = _mm512_add_epi64(sum1, _mm512_loadu_si512(data + i + 8));
+			}
+
+			alignas(64) uint64_t lanes[8];
+			_mm512_store_si512(lanes, _mm512_add_epi64(sum0, sum1));
+
+			uint64_t sum = (uint64_t) SumScalar(data + i, size - i);
+
+			for (uint64_t lane : lanes)
+			{
+				sum += lane;
+			}
+
+			return (SQLiteInt) sum;
+		}
+
+		DATABASECORE_TARGET_AVX512
+		SQLiteReal SumAVX512(const SQLiteReal* data, size_t size)
+		{
+			__m512d sum0 = _mm512_setzero_pd();
+			__m512d sum1 = _mm512_setzero_pd();
+			__m512d sum2 = _mm512_setzero_pd();
+			__m512d sum3 = _mm512_setzero_pd();
+
+			size_t i = 0;
+
+			for (; i + 32 <= size; i += 32)
+			{
+				sum0 = _mm512_add_pd(sum0, _mm512_loadu_pd(data + i));
+				sum1 = _mm512_add_pd(sum1, _mm512_loadu_pd(data + i + 8));
+				sum2 = _mm512_add_pd(sum2, _mm512_loadu_pd(data + i + 16));
+				sum3 = _mm512_add_pd(sum3, _mm512_loadu_pd(data + i + 24));
+			}
+
+			alignas(64) double lanes[8];
+			_mm512_store_pd(lanes, _mm512_add_pd(
+				_mm512_add_pd(sum0, sum1),
+				_mm512_add_pd(sum2, sum3)));
+
+			double sum = 0;
+
+			for (double lane : lanes)
+			{
+				sum += lane;
+			}
+
+			return sum + SumScalar(data + i, size - i);
+		}
+
+		DATABASECORE_TARGET_AVX512
+		void MinMaxAVX512(const SQLiteInt* data, size_t size, SQLiteInt& min, SQLiteInt& max)
+		{
+			__m512i minimum = _mm512_set1_epi64(min);
+			__m512i maximum = _mm512_set1_epi64(max);
+
+			size_t i = 0;
+
+			for (; i + 8 <= size; i += 8)
+			{
+				const __m512i value = _mm512_loadu_si512(data + i);
+
+				minimum = _mm512_min_epi64(minimum, value);
+				maximum = _mm512_max_epi64(maximum, value);
+			}
+
+			alignas(64) SQLiteInt minimum_lanes[8];
+			alignas(64) SQLiteInt maximum_lanes[8];
+
+			_mm512_store_si512(minimum_lanes, minimum);
+			_mm512_store_si512(maximum_lanes, maximum);
+
+			MinMaxScalar(minimum_lanes, 8, min, max);
+			MinMaxScalar(maximum_lanes, 8, min, max);
+			MinMaxScalar(data + i, size - i, min, max);
+		}
+
+		DATABASECORE_TARGET_AVX512
+		void MinMaxAVX512(const SQLiteReal* data, size_t size, SQLiteReal& min, SQLiteReal& max)
+		{
+			__m512d minimum = _mm512_set1_pd(min);
+			__m512d maximum = _mm512_set1_pd(max);
+
+			size_t i = 0;
+
+			for (; i + 8 <= size; i += 8)
+			{
+				const __m512d value = _mm512_loadu_pd(data + i);
+
+				minimum = _mm512_min_pd(minimum, value);
+				maximum = _mm512_max_pd(maximum, value);
+			}
+
+			alignas(64) SQLiteReal minimum_lanes[8];
+			alignas(64) SQLiteReal maximum_lanes[8];
+
+			_mm512_store_pd(minimum_lanes, minimum);
+			_mm512_store_pd(maximum_lanes, maximum);
+
+			MinMaxScalar(minimum_lanes, 8, min, max);
+			MinMaxScalar(maximum_lanes, 8, min, max);
+			MinMaxScalar(data + i, size - i, min, max);
+		}
+
+		template <int Predicate>
+		DATABASECORE_TARGET_AVX512
+		size_t FilterAVX512(const SQLiteInt* data, size_t size,
+			SQLiteInt operand,
+			uint32_t* selection)
+		{
+			const __m512i operand_lanes = _mm512_set1_epi64(operand);
+			const __m512i lanes = _mm512_set_epi32(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0);
+
+			size_t count = 0;
+
+			// two compares fill the sixteen 32 bit indices of one compress
+			for (size_t i = 0; i + 16 <= size; i += 16)
+			{
+				const __mmask16 mask = (__mmask16) (
+					_mm512_cmp_epi64_mask(_mm512_loadu_si512(data + i), operand_lanes, Predicate)
+					| (_mm512_cmp_epi64_mask(_mm512_loadu_si512(data + i + 8), operand_lanes, Predicate) << 8));
+
+				_mm512_mask_compressstoreu_epi32(selection + count, mask,
+					_mm512_add_epi32(lanes, _mm512_set1_epi32((int) i)));
+				count += _mm_popcnt_u32(mask);
+			}
+
+			return count;
+		}
+
+		template <int Predicate>
+		DATABASECORE_TARGET_AVX512
+		size_t FilterAVX512(const SQLiteReal* data, size_t size,
+			SQLiteReal operand,
+			uint32_t* selection)
+		{
+			const __m512d operand_lanes = _mm512_set1_pd(operand);
+			const __m512i lanes = _mm512_set_epi32(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0);
+
+			size_t count = 0;
+
+			for (size_t i = 0; i + 16 <= size; i += 16)
+			{
+				const __mmask16 mask = (__mmask16) (
+					_mm512_cmp_pd_mask(_mm512_loadu_pd(data + i), operand_lanes, Predicate)
+					| (_mm512_cmp_pd_mask(_mm512_loadu_pd(data + i + 8), operand_lanes, Predicate) << 8));
+
+				_mm512_mask_compressstoreu_epi32(selection + count, mask,
+					_mm512_add_epi32(lanes, _mm512_set1_epi32((int) i)));
+				count += _mm_popcnt_u32(mask);
+			}
+
+			return count;
+		}
+
+		template <typename T>
+		DATABASECORE_TARGET_AVX512
+		size_t FilterAVX512(const T* data, size_t size,
+			SQLiteCompare compare, T operand,
+			uint32_t* selection)
+		{
+			constexpr bool integral = std::is_integral_v<T>;
+			size_t count = 0;
+
+			switch (compare)
+			{
+			case SQLiteCompare::Less:
+				count = FilterAVX512<integral ? _MM_CMPINT_LT : _CMP_LT_OQ>(data, size, operand, selection);
+				break;
+			case SQLiteCompare::LessEqual:
+				count = FilterAVX512<integral ? _MM_CMPINT_LE : _CMP_LE_OQ>(data, size, operand, selection);
+				break;
+			case SQLiteCompare::Greater:
+				count = FilterAVX512<integral ? _MM_CMPINT_NLE : _CMP_GT_OQ>(data, size, operand, selection);
+				break;
+			case SQLiteCompare::GreaterEqual:
+				count = FilterAVX512<integral ? _MM_CMPINT_NLT : _CMP_GE_OQ>(data, size, operand, selection);
+				break;
+			case SQLiteCompare::Equal:
+				count = FilterAVX512<integral ? _MM_CMPINT_EQ : _CMP_EQ_OQ>(data, size, operand, selection);
+				break;
+			case SQLiteCompare::NotEqual:
+				count = FilterAVX512<integral ? _MM_CMPINT_NE : _CMP_NEQ_UQ>(data, size, operand, selection);
+				break;
+			}
+
+			const size_t tail = size - size % 16;
+			return count + FilterScalar(data, tail, size, compare, operand, selection + count);
+		}
+
+		DATABASECORE_TARGET_AVX512
+		void BinAVX512(const SQLiteInt* data, size_t size,
+			SQLiteInt min, SQLiteInt max, SQLiteReal scale, uint32_t last,
+			uint32_t* bins)
+		{
+			const __m512i minimum = _mm512_set1_epi64(min);
+			const __m512i maximum = _mm512_set1_epi64(max);
+			const __m512i magic = _mm512_set1_epi64((long long) BinMagic);
+			const __m512d magic_value = _mm512_set1_pd(BinMagicValue);
+			const __m512d scale_lanes = _mm512_set1_pd(scale);
+			const __m512d last_lanes = _mm512_set1_pd(last);
+			const __m512d drop_lanes = _mm512_set1_pd((SQLiteReal) last + 1);
+
+			size_t i = 0;
+
+			for (; i + 8 <= size; i += 8)
+			{
+				const __m512i value = _mm512_loadu_si512(data + i);
+				const __mmask8 inside = (__mmask8) (
+					_mm512_cmp_epi64_mask(value, minimum, _MM_CMPINT_NLT)
+					& _mm512_cmp_epi64_mask(value, maximum, _MM_CMPINT_LE));
+
+				const __m512d offset = _mm512_sub_pd(
+					_mm512_castsi512_pd(_mm512_or_si512(_mm512_sub_epi64(value, minimum), magic)),
+					magic_value);
+				const __m512d bin = _mm512_mask_blend_pd(inside,
+					drop_lanes,
+					_mm512_min_pd(_mm512_mul_pd(offset, scale_lanes), last_lanes));
+
+				_mm256_storeu_si256((__m256i*) (bins + i), _mm512_cvttpd_epi32(bin));
+			}
+
+			BinScalar(data, i, size, min, max, scale, last, bins);
+		}
+
+		DATABASECORE_TARGET_AVX512
+		void BinAVX512(const SQLiteReal* data, size_t size,
+			SQLiteReal min, SQLiteReal max, SQLiteReal scale, uint32_t last,
+			uint32_t* bins)
+		{
+			const __m512d minimum = _mm512_set1_pd(min);
+			const __m512d maximum = _mm512_set1_pd(max);
+			const __m512d scale_lanes = _mm512_set1_pd(scale);
+			const __m512d last_lanes = _mm512_set1_pd(last);
+			const __m512d drop_lanes = _mm512_set1_pd((SQLiteReal) last + 1);
+
+			size_t i = 0;
+
+			for (; i + 8 <= size; i += 8)
+			{
+				const __m512d value = _mm512_loadu_pd(data + i);
+				const __mmask8 inside = (__mmask8) (
+					_mm512_cmp_pd_mask(value, minimum, _CMP_GE_OQ)
+					& _mm512_cmp_pd_mask(value, maximum, _CMP_LE_OQ));
+
+				const __m512d bin = _mm512_mask_blend_pd(inside,
+					drop_lanes,
+					_mm512_min_pd(_mm512_mul_pd(_mm512_sub_pd(value, minimum), scale_lanes), last_lanes));
+
+				_mm256_storeu_si256((__m256i*) (bins + i), _mm512_cvttpd_epi32(bin));
+			}
+
+			BinScalar(data, i, size, min, max, scale, last, bins);
+		}
+#endif
+
+		template <typename T>
+		T Sum(const T* data, size_t size)
+		{
+#ifdef DATABASECORE_KERNELS_X64
+			switch (GetKernelLevel())
+			{
+			case SQLiteKernelLevel::AVX512:
+				return SumAVX512(data, size);
+			case SQLiteKernelLevel::AVX2:
+				return SumAVX2(data, size);
+			default:
+				break;
+			}
+#endif
+			return SumScalar(data, size);
+		}
+
+		template <typename T>
+		std::optional<std::pair<T, T>> MinMax(const T* data, size_t size)
+		{
+			if (size == 0)
+			{
+				return std::nullopt;
+			}
+
+			T min = data[0];
+			T max = data[0];
+
+#ifdef DATABASECORE_KERNELS_X64
+			switch (GetKernelLevel())
+			{
+			case SQLiteKernelLevel::AVX512:
+				MinMaxAVX512(data, size, min, max);
+				return std::make_pair(min, max);
+			case SQLiteKernelLevel::AVX2:
+				MinMaxAVX2(data, size, min, max);
+				return std::make_pair(min, max);
+			default:
+				break;
+			}
+#endif
+			MinMaxScalar(data, size, min, max);
+			return std::make_pair(min, max);
+		}
+
+		template <typename T>
+		bool Filter(const T* data, size_t size,
+			SQLiteCompare compare, T operand,
+			std::vector<uint32_t>& selection)
+		{
+			if (size > std::numeric_limits<uint32_t>::max())
+			{
+				if (OnDatabaseCoreFailure)
+					OnDatabaseCoreFailure("tried to filter column with more rows than selection indices can hold");
+
+				selection.clear();
+				return false;
+			}
+
+			// the kernels write the indices of all candidates and only
+			// advance past selected ones, so they need room for every value
+			selection.resize(size);
+			size_t count = 0;
+
+#ifdef DATABASECORE_KERNELS_X64
+			switch (GetKernelLevel())
+			{
+			case SQLiteKernelLevel::AVX512:
+				count = FilterAVX512(data, size, compare, operand, selection.data());
+				break;
+			case SQLiteKernelLevel::AVX2:
+				count = FilterAVX2(data, size, compare, operand, selection.data());
+				break;
+			default:
+				count = FilterScalar(data, 0, size, compare, operand, selection.data());
+				break;
+			}
+#else
+			count = FilterScalar(data, 0, size, compare, operand, selection.data());
+#endif
+			selection.resize(count);
+			return true;
+		}
+
+		template <typename T>
+		void Histogram(const T* data, size_t size,
+			T min, T max,
+			std::vector<size_t>& bins)
+		{
+			if (bins.empty() || !(min <= max))
+			{
+				return;
+			}
+
+			// one more bin per table collects the dropped values
+			const size_t bin_count = bins.size();
+			const size_t table_size = bin_count + 1;
+
+			if (bin_count >= (size_t) std::numeric_limits<int32_t>::max())
+			{
+				if (OnDatabaseCoreFailure)
+					OnDatabaseCoreFailure("tried to build histogram with more bins than bin indices can hold");
+
+				return;
+			}
+
+			const uint32_t last = (uint32_t) bin_count - 1;
+			const SQLiteReal scale = max > min
+				? bin_count / ((SQLiteReal) max - (SQLiteReal) min)
+				: 0.0;
+
+			SQLiteKernelLevel level = GetKernelLevel();
+
+			// see BinMagic
+			if constexpr (std::is_integral_v<T>)
+			{
+				if ((uint64_t) max - (uint64_t) min >= (uint64_t) 1 << 52)
+				{
+					level = SQLiteKernelLevel::Scalar;
+				}
+			}
+
+			// increments of the same bin in a row would wait on each other.
+			// four separate tables keep consecutive values independent
+			std::vector<size_t> counts(table_size * 4);
+
+			// bins are computed in chunks, vectorized where supported, and
+			// counted afterwards
+			constexpr size_t ChunkSize = 256;
+			uint32_t chunk[ChunkSize];
+
+			for (size_t begin = 0; begin < size; begin += ChunkSize)
+			{
+				const size_t chunk_size = std::min(ChunkSize, size - begin);
+
+#ifdef DATABASECORE_KERNELS_X64
+				switch (level)
+				{
+				case SQLiteKernelLevel::AVX512:
+					BinAVX512(data + begin, chunk_size, min, max, scale, last, chunk);
+					break;
+				case SQLiteKernelLevel::AVX2:
+					BinAVX2(data + begin, chunk_size, min, max, scale, last, chunk);
+					break;
+				default:
+					BinScalar(data + begin, 0, chunk_size, min, max, scale, last, chunk);
+					break;
+				}
+#else
+				BinScalar(data + begin, 0, chunk_size, min, max, scale, last, chunk);
+#endif
+
+				size_t i = 0;
+
+				for (; i + 4 <= chunk_size; i += 4)
+				{
+					++counts[chunk[i]];
+					++counts[table_size + chunk[i + 1]];
+					++counts[2 * table_size + chunk[i + 2]];
+					++counts[3 * table_size + chunk[i + 3]];
+				}
+
+				for (; i < chunk_size; ++i)
+				{
+					++counts[chunk[i]];
+				}
+			}
+
+			for (size_t bin = 0; bin < bin_count; ++bin)
+			{
+				bins[bin] += counts[bin]
+					+ counts[table_size + bin]
+					+ counts[2 * table_size + bin]
+					+ counts[3 * table_size + bin];
+			}
+		}
+	}
+
+	SQLiteKernelLevel GetSupportedKernelLevel()
+	{
+		static const SQLiteKernelLevel level = DetectKernelLevel();
+		return level;
+	}
+
+	SQLiteKernelLevel GetKernelLevel()
+	{
+		return GetKernelLevelStorage().load(std::memory_order_relaxed);
+	}
+
+	void SetKernelLevel(SQLiteKernelLevel level)
+	{
+		GetKernelLevelStorage().store(
+			std::min(level, GetSupportedKernelLevel()),
+			std::memory_order_relaxed);
+	}
+
+	SQLiteInt ColumnSum(const SQLiteInt* data, size_t size)
+	{
+		return Sum(data, size);
+	}
+
+	SQLiteReal ColumnSum(const SQLiteReal* data, size_t size)
+	{
+		return Sum(data, size);
+	}
+
+	std::optional<std::pair<SQLiteInt, SQLiteInt>> ColumnMinMax(const SQLiteInt* data, size_t size)
+	{
+		return MinMax(data, size);
+	}
+
+	std::optional<std::pair<SQLiteReal, SQLiteReal>> ColumnMinMax(const SQLiteReal* data, size_t size)
+	{
+		return MinMax(data, size);
+	}
+
+	bool ColumnFilter(const SQLiteInt* data, size_t size,
+		SQLiteCompare compare, SQLiteInt operand,
+		std::vector<uint32_t>& selection)
+	{
+		return Filter(data, size, compare, operand, selection);
+	}
+
+	bool ColumnFilter(const SQLiteReal* data, size_t size,
+		SQLiteCompare compare, SQLiteReal operand,
+		std::vector<uint32_t>& selection)
+	{
+		return Filter(data, size, compare, operand, selection);
+	}
+
+	void ColumnHistogram(const SQLiteInt* data, size_t size,
+		SQLiteInt min, SQLiteInt max,
+		std::vector<size_t>& bins)
+	{
+		Histogram(data, size, min, max, bins);
+	}
+
+	void ColumnHistogram(const SQLiteReal* data, size_t size,
+		SQLiteReal min, SQLiteReal max,
+		std::vector<size_t>& bins)
+	{
+		Histogram(data, size, min, max, bins);
+	}
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include "DatabaseCore.h"
+
+#include <cstdint>
+#include <optional>
+#include <utility>
+#include <vector>
+
+// client side kernels over numeric columns, for example the columns of a
+// SQLiteColumnBatch. every kernel dispatches at runtime to avx-512, avx2
+// or a scalar fallback. vectorized floating point sums add in a different
+// order than the scalar loop, so their results can differ in the last
+// bits. nan values give unspecified results for min, max and sum
+namespace Database
+{
+	enum class SQLiteKernelLevel
+	{
+		Scalar,
+		AVX2,
+		AVX512
+	};
+
+	// highest level supported by the cpu and the operating system
+	SQLiteKernelLevel GetSupportedKernelLevel();
+
+	SQLiteKernelLevel GetKernelLevel();
+	// limits the kernels to level, for example to compare them in
+	// benchmarks. levels above the supported level are clamped
+	void SetKernelLevel(SQLiteKernelLevel level);
+
+	enum class SQLiteCompare
+	{
+		Less,
+		LessEqual,
+		Greater,
+		GreaterEqual,
+		Equal,
+		NotEqual
+	};
+
+	// integer sums wrap around on overflow
+	SQLiteInt ColumnSum(const SQLiteInt* data, size_t size);
+	SQLiteReal ColumnSum(const SQLiteReal* data, size_t size);
+
+	// empty for empty columns
+	std::optional<std::pair<SQLiteInt, SQLiteInt>> ColumnMinMax(const SQLiteInt* data, size_t size);
+	std::optional<std::pair<SQLiteReal, SQLiteReal>> ColumnMinMax(const SQLiteReal* data, size_t size);
+
+	// replaces selection with the indices of all values for which
+	// "value compare operand" holds, in ascending order. fails for
+	// columns with more values than uint32_t indices can address
+	bool ColumnFilter(const SQLiteInt* data, size_t size,
+		SQLiteCompare compare, SQLiteInt operand,
+		std::vector<uint32_t>& selection);
+	bool ColumnFilter(const SQLiteReal* data, size_t size,
+		SQLiteCompare compare, SQLiteReal operand,
+		std::vector<uint32_t>& selection);
+
+	// splits [min, max] into bins.size() equal bins and adds the number
+	// of values in every bin to bins. values outside of the range are
+	// ignored, max falls into the last bin. integer columns spanning
+	// 2^52 or more are binned by the scalar kernel
+	void ColumnHistogram(const SQLiteInt* data, size_t size,
+		SQLiteInt min, SQLiteInt max,
+		std::vector<size_t>& bins);
+	void ColumnHistogram(const SQLiteReal* data, size_t size,
+		SQLiteReal min, SQLiteReal max,
+		std::vector<size_t>& bins);
+
+	template <typename T>
+	T ColumnSum(const std::vector<T>& column)
+	{
+		return ColumnSum(column.data(), column.size());
+	}
+
+	template <typename T>
+	std::optional<std::pair<T, T>> ColumnMinMax(const std::vector<T>& column)
+	{
+		return ColumnMinMax(column.data(), column.size());
+	}
+
+	template <typename T>
+	bool ColumnFilter(const std::vector<T>& column,
+		SQLiteCompare compare, T operand,
+		std::vector<uint32_t>& selection)
+	{
+		return ColumnFilter(column.data(), column.size(), compare, operand, selection);
+	}
+
+	template <typename T>
+	void ColumnHistogram(const std::vector<T>& column,
+		T min, T max,
+		std::vector<size_t>& bins)
+	{
+		ColumnHistogram(column.data(), column.size(), min, max, bins);
+	}
+}
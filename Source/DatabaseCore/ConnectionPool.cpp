@@ -0,0 +1,130 @@
+#include "ConnectionPool.h"
+
+namespace Database
+{
+	void SQLitePooledConnection::release()
+	{
+		if (database)
+		{
+			pool->release(database);
+
+			pool = NULL;
+			database = NULL;
+		}
+	}
+
+	SQLiteOpenOptions SQLiteConnectionPool::DefaultOpenOptions()
+	{
+		SQLiteOpenOptions options;
+		options.threading = SQLiteThreadingMode::MultiThread;
+
+		return options;
+	}
+
+	SQLiteConnectionPool::SQLiteConnectionPool(
+		std::string filename,
+		size_t reader_count,
+		const SQLiteOpenOptions& options,
+		std::optional<SQLiteTuning> reader_tuning)
+		:
+		writer(std::make_unique<SQLiteDatabase>(filename, options)),
+		valid(*writer),
+		tuned(writer->is_tuned()),
+		writer_idle(true)
+	{
+		SQLiteOpenOptions reader_options = options;
+		reader_options.read_only = true;
+		reader_options.tuning = std::move(reader_tuning);
+
+		readers.reserve(reader_count);
+		idle_readers.reserve(reader_count);
+
+		for (size_t i = 0; i < reader_count; ++i)
+		{
+			std::unique_ptr<SQLiteDatabase>& reader = readers.emplace_back(
+				std::make_unique<SQLiteDatabase>(filename, reader_options));
+
+			valid = valid && *reader;
+			tuned = tuned && reader->is_tuned();
+			idle_readers.push_back(reader.get());
+		}
+	}
+
+	SQLiteConnectionPool::~SQLiteConnectionPool()
+	{
+		assert(writer_idle && idle_readers.size() == readers.size());
+	}
+
+	SQLitePooledConnection SQLiteConnectionPool::acquire_reader()
+	{
+		std::unique_lock lock(mutex);
+		reader_available.wait(lock, [this]() { return !idle_readers.empty(); });
+
+		SQLiteDatabase* reader = idle_readers.back();
+		idle_readers.pop_back();
+
+		return SQLitePooledConnection{ this, reader };
+	}
+
+	SQLitePooledConnection SQLiteConnectionPool::acquire_writer()
+	{
+		std::unique_lock lock(mutex);
+		writer_available.wait(lock, [this]() { return writer_idle; });
+
+		writer_idle = false;
+		return SQLitePooledConnection{ this, writer.get() };
+	}
+
+	SQLitePooledConnection SQLiteConnectionPool::try_acquire_reader(std::chrono::milliseconds timeout)
+	{
+		std::unique_lock lock(mutex);
+
+		if (!reader_available.wait_for(lock, timeout, [this]() { return !idle_readers.empty(); }))
+		{
+			return SQLitePooledConnection{ };
+		}
+
+		SQLiteDatabase* reader = idle_readers.back();
+		idle_readers.pop_back();
+
+		return SQLitePooledConnection{ this, reader };
+	}
+
+	SQLitePooledConnection SQLiteConnectionPool::try_acquire_writer(std::chrono::milliseconds timeout)
+	{
+		std::unique_lock lock(mutex);
+
+		if (!writer_available.wait_for(lock, timeout, [this]() { return writer_idle; }))
+		{
+			return SQLitePooledConnection{ };
+		}
+
+		writer_idle = false;
+		return SQLitePooledConnection{ this, writer.get() };
+	}
+
+	void SQLiteConnectionPool::release(SQLiteDatabase* database)
+	{
+		{
+			std::lock_guard lock(mutex);
+
+			if (database == writer.get())
+			{
+				writer_idle = true;
+			}
+			else
+			{
+				idle_readers.push_back(database);
+			}
+		}
+
+		if (database == writer.get())
+		{
+			writer_available.notify_one();
+		}
+		else
+		{
+			reader_available.notify_one();
+		}
+	}
+}
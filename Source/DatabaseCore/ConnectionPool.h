@@ -0,0 +1,157 @@
+#pragma once
+
+#include "DatabaseCore.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+
+namespace Database
+{
+	class SQLiteConnectionPool;
+
+	// checked out connection. returns it to its pool on destruction
+	class SQLitePooledConnection
+	{
+		friend class SQLiteConnectionPool;
+
+		SQLitePooledConnection(SQLiteConnectionPool* pool, SQLiteDatabase* database)
+			:
+			pool(pool),
+			database(database)
+		{
+		}
+
+	public:
+		SQLitePooledConnection() = default;
+
+		SQLitePooledConnection(SQLitePooledConnection&& other) noexcept
+			:
+			pool(other.pool),
+			database(other.database)
+		{
+			other.pool = NULL;
+			other.database = NULL;
+		}
+
+		SQLitePooledConnection& operator=(SQLitePooledConnection&& other) noexcept
+		{
+			if (this != &other)
+			{
+				release();
+
+				pool = other.pool;
+				database = other.database;
+
+				other.pool = NULL;
+				other.database = NULL;
+			}
+
+			return *this;
+		}
+
+		~SQLitePooledConnection()
+		{
+			release();
+		}
+
+		// false if no connection could be acquired
+		operator bool() const
+		{
+			return database != NULL;
+		}
+
+		SQLiteDatabase* operator->() const
+		{
+			return database;
+		}
+
+		SQLiteDatabase& operator*() const
+		{
+			return *database;
+		}
+
+		SQLiteDatabase* get() const
+		{
+			return database;
+		}
+
+		void release();
+
+	private:
+		SQLiteConnectionPool* pool = NULL;
+		SQLiteDatabase* database = NULL;
+	};
+
+	// opens reader_count read only connections and one writer connection
+	// to the same file. every connection keeps its own statement cache.
+	// readers only run concurrently to the writer in wal journal mode
+	class SQLiteConnectionPool
+	{
+		friend class SQLitePooledConnection;
+
+	public:
+		// pooled connections are never used by two threads at once, so
+		// the default threading mode is SQLiteThreadingMode::MultiThread
+		static SQLiteOpenOptions DefaultOpenOptions();
+
+		// readers are always opened read only. the tuning of options is
+		// only applied to the writer, readers use reader_tuning instead,
+		// as journal mode or synchronous can not be set read only
+		SQLiteConnectionPool(std::string filename, size_t reader_count,
+			const SQLiteOpenOptions& options = DefaultOpenOptions(),
+			std::optional<SQLiteTuning> reader_tuning = std::nullopt);
+
+		// all connections have to be returned before destruction
+		~SQLiteConnectionPool();
+
+		SQLiteConnectionPool(const SQLiteConnectionPool&) = delete;
+		SQLiteConnectionPool& operator=(const SQLiteConnectionPool&) = delete;
+
+		// false if any connection failed to open
+		operator bool() const
+		{
+			return valid;
+		}
+
+		// false if any connection failed to apply its tuning
+		bool is_tuned() const
+		{
+			return tuned;
+		}
+
+		// blocks until a connection is available
+		SQLitePooledConnection acquire_reader();
+		SQLitePooledConnection acquire_writer();
+
+		// returns an empty connection if none is available in time
+		SQLitePooledConnection try_acquire_reader(
+			std::chrono::milliseconds timeout = std::chrono::milliseconds::zero());
+		SQLitePooledConnection try_acquire_writer(
+			std::chrono::milliseconds timeout = std::chrono::milliseconds::zero());
+
+		size_t get_reader_count() const
+		{
+			return readers.size();
+		}
+
+	private:
+		std::vector<std::unique_ptr<SQLiteDatabase>> readers;
+		std::unique_ptr<SQLiteDatabase> writer;
+		bool valid;
+		bool tuned;
+
+		std::mutex mutex;
+		std::condition_variable reader_available;
+		std::condition_variable writer_available;
+
+		std::vector<SQLiteDatabase*> idle_readers;
+		bool writer_idle;
+
+		void release(SQLiteDatabase* database);
+	};
+
+	using ConnectionPool = SQLiteConnectionPool;
+	using PooledConnection = SQLitePooledConnection;
+}
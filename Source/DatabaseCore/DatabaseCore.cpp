@@ -1,5 +1,11 @@
 #include "DatabaseCore.h"
 
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <thread>
+
 #ifdef _DEBUG
 #include <iostream>
 #endif
@@ -18,6 +24,7 @@ std::function<void(int, const char*)> OnSQLiteFailure =
 		std::cout << "SQLite failure: " << error_message << "(" << sqlite3_errstr(error_code) << ")" << std::endl;
 	};
 #else
+	std::function<void(const char*)> OnDatabaseCoreFailure;
 	std::function<void(int, const char*)> OnSQLiteFailure;
 #endif
 
@@ -33,4 +40,1165 @@ std::function<void(int, const char*)> OnSQLiteFailure =
 
 		return true;
 	}
+
+	int SQLiteOpenOptions::get_flags() const
+	{
+		int flags = read_only
+			? SQLITE_OPEN_READONLY
+			: SQLITE_OPEN_READWRITE | (create ? SQLITE_OPEN_CREATE : 0);
+
+		if (uri)
+			flags |= SQLITE_OPEN_URI;
+
+		if (memory)
+			flags |= SQLITE_OPEN_MEMORY;
+
+		// default keeps the mode sqlite was configured with
+		switch (threading)
+		{
+		case SQLiteThreadingMode::Default:
+			break;
+		case SQLiteThreadingMode::MultiThread:
+			flags |= SQLITE_OPEN_NOMUTEX;
+
+			break;
+		case SQLiteThreadingMode::Serialized:
+			flags |= SQLITE_OPEN_FULLMUTEX;
+
+			break;
+		}
+
+		switch (cache)
+		{
+		case SQLiteCacheMode::Default:
+			break;
+		case SQLiteCacheMode::Shared:
+			flags |= SQLITE_OPEN_SHAREDCACHE;
+
+			break;
+		case SQLiteCacheMode::Private:
+			flags |= SQLITE_OPEN_PRIVATECACHE;
+
+			break;
+		}
+
+		return flags;
+	}
+
+	SQLiteTuning SQLiteTuning::ReadHeavy()
+	{
+		SQLiteTuning tuning;
+
+		tuning.journal_mode = SQLiteJournalMode::Wal;
+		tuning.synchronous = SQLiteSynchronous::Normal;
+		tuning.temp_store = SQLiteTempStore::Memory;
+		tuning.mmap_size = 256 * 1024 * 1024;
+		tuning.cache_size = -64 * 1024;
+		tuning.busy_timeout = 5000;
+
+		return tuning;
+	}
+
+	SQLiteTuning SQLiteTuning::BulkLoad()
+	{
+		SQLiteTuning tuning;
+
+		tuning.journal_mode = SQLiteJournalMode::Off;
+		tuning.synchronous = SQLiteSynchronous::Off;
+		tuning.temp_store = SQLiteTempStore::Memory;
+		tuning.cache_size = -256 * 1024;
+		tuning.busy_timeout = 5000;
+
+		return tuning;
+	}
+
+	SQLiteTuning SQLiteTuning::Durable()
+	{
+		SQLiteTuning tuning;
+
+		tuning.journal_mode = SQLiteJournalMode::Wal;
+		tuning.synchronous = SQLiteSynchronous::Full;
+		tuning.busy_timeout = 5000;
+
+		return tuning;
+	}
+
+	bool SQLiteTuning::validate() const
+	{
+		if (page_size && (*page_size < 512 || *page_size > 65536
+			|| (*page_size & (*page_size - 1)) != 0))
+		{
+			if (OnDatabaseCoreFailure)
+				OnDatabaseCoreFailure("tuning page_size has to be a power of two between 512 and 65536");
+
+			return false;
+		}
+
+		if (mmap_size && *mmap_size < 0)
+		{
+			if (OnDatabaseCoreFailure)
+				OnDatabaseCoreFailure("tuning mmap_size can not be negative");
+
+			return false;
+		}
+
+		if (busy_timeout && *busy_timeout < 0)
+		{
+			if (OnDatabaseCoreFailure)
+				OnDatabaseCoreFailure("tuning busy_timeout can not be negative");
+
+			return false;
+		}
+
+		return true;
+	}
+
+	SQLiteBusyPolicy SQLiteBusyPolicy::Timeout(std::chrono::milliseconds timeout)
+	{
+		SQLiteBusyPolicy policy;
+
+		policy.strategy = SQLiteBusyStrategy::Timeout;
+		policy.timeout = timeout;
+
+		return policy;
+	}
+
+	SQLiteBusyPolicy SQLiteBusyPolicy::Backoff(std::chrono::milliseconds timeout)
+	{
+		SQLiteBusyPolicy policy;
+
+		policy.strategy = SQLiteBusyStrategy::Backoff;
+		policy.timeout = timeout;
+
+		return policy;
+	}
+
+	SQLiteBusyPolicy SQLiteBusyPolicy::Yield(std::chrono::milliseconds timeout)
+	{
+		SQLiteBusyPolicy policy;
+
+		policy.strategy = SQLiteBusyStrategy::Yield;
+		policy.timeout = timeout;
+
+		return policy;
+	}
+
+	bool SQLiteBusyPolicy::validate() const
+	{
+		if (timeout.count() < 0)
+		{
+			if (OnDatabaseCoreFailure)
+				OnDatabaseCoreFailure("busy policy timeout can not be negative");
+
+			return false;
+		}
+
+		if (strategy == SQLiteBusyStrategy::Backoff
+			&& (initial_delay.count() <= 0 || max_delay < initial_delay))
+		{
+			if (OnDatabaseCoreFailure)
+				OnDatabaseCoreFailure("busy policy delays have to be positive with max_delay not below initial_delay");
+
+			return false;
+		}
+
+		if (strategy == SQLiteBusyStrategy::Backoff
+			&& (multiplier < 1.0 || jitter < 0.0 || jitter > 1.0))
+		{
+			if (OnDatabaseCoreFailure)
+				OnDatabaseCoreFailure("busy policy multiplier has to be at least one and jitter between zero and one");
+
+			return false;
+		}
+
+		return true;
+	}
+
+	namespace
+	{
+		// runs a pragma and returns its first value if it has one. most
+		// pragmas that set a value return no columns, so the statement is
+		// prepared directly instead of being cached and column validated
+		bool ExecutePragma(SQLiteDatabase* database, const std::string& pragma,
+			std::optional<SQLiteString>* result = NULL)
+		{
+			sqlite3_stmt* statement = NULL;
+
+			if (!EnsureSQLiteStatusCode(
+					sqlite3_prepare_v2(database->get_database(), pragma.c_str(), -1, &statement, NULL),
+					"failed to prepare pragma"))
+			{
+				return false;
+			}
+
+			int code;
+
+			while ((code = sqlite3_step(statement)) == SQLITE_ROW)
+			{
+				if (result && !*result
+					&& sqlite3_column_count(statement) > 0
+					&& sqlite3_column_type(statement, 0) != SQLITE_NULL)
+				{
+					*result = SQLiteString((const char*) sqlite3_column_text(statement, 0));
+				}
+			}
+
+			sqlite3_finalize(statement);
+
+			return EnsureSQLiteStatusCode(
+				code == SQLITE_DONE ? SQLITE_OK : code,
+				"failed to execute pragma");
+		}
+
+		const char* JournalModeName(SQLiteJournalMode mode)
+		{
+			switch (mode)
+			{
+			case SQLiteJournalMode::Truncate:
+				return "truncate";
+			case SQLiteJournalMode::Persist:
+				return "persist";
+			case SQLiteJournalMode::Memory:
+				return "memory";
+			case SQLiteJournalMode::Wal:
+				return "wal";
+			case SQLiteJournalMode::Off:
+				return "off";
+			default:
+				return "delete";
+			}
+		}
+	}
+
+	bool SQLiteDatabase::tune(const SQLiteTuning& tuning)
+	{
+		tuned = false;
+
+		if (!tuning.validate())
+		{
+			return false;
+		}
+
+		bool result = true;
+
+		// page size has to be set before the journal mode changes to wal
+		if (tuning.page_size)
+		{
+			result &= ExecutePragma(this, "PRAGMA page_size = " + std::to_string(*tuning.page_size));
+		}
+
+		if (tuning.journal_mode)
+		{
+			const std::string mode = JournalModeName(*tuning.journal_mode);
+			std::optional<SQLiteString> applied;
+
+			if (!ExecutePragma(this, "PRAGMA journal_mode = " + mode, &applied))
+			{
+				result = false;
+			}
+			// for example in memory databases do not support wal
+			else if (!applied || !std::equal(mode.begin(), mode.end(), applied->begin(), applied->end(),
+				[](char a, char b) { return std::tolower(a) == std::tolower(b); }))
+			{
+				if (OnDatabaseCoreFailure)
+					OnDatabaseCoreFailure("database does not support tuning journal_mode");
+
+				result = false;
+			}
+		}
+
+		if (tuning.synchronous)
+		{
+			result &= ExecutePragma(this, "PRAGMA synchronous = "
+				+ std::to_string((int) *tuning.synchronous));
+		}
+
+		if (tuning.temp_store)
+		{
+			result &= ExecutePragma(this, "PRAGMA temp_store = "
+				+ std::to_string((int) *tuning.temp_store));
+		}
+
+		if (tuning.mmap_size)
+		{
+			result &= ExecutePragma(this, "PRAGMA mmap_size = " + std::to_string(*tuning.mmap_size));
+		}
+
+		if (tuning.cache_size)
+		{
+			result &= ExecutePragma(this, "PRAGMA cache_size = " + std::to_string(*tuning.cache_size));
+		}
+
+		if (tuning.busy_timeout)
+		{
+			result &= set_busy_policy(SQLiteBusyPolicy::Timeout(
+				std::chrono::milliseconds(*tuning.busy_timeout)));
+		}
+
+		tuned = result;
+		return result;
+	}
+
+	bool SQLiteDatabase::set_busy_policy(const SQLiteBusyPolicy& policy)
+	{
+		if (!policy.validate())
+		{
+			return false;
+		}
+
+		if (!EnsureSQLiteStatusCode(
+				sqlite3_busy_handler(
+					database,
+					policy.strategy == SQLiteBusyStrategy::Fail ? NULL : &SQLiteDatabase::BusyHandler,
+					this),
+				"failed to set busy handler"))
+		{
+			return false;
+		}
+
+		busy_policy = policy;
+
+		// connections must not share their jitter
+		busy_random ^= (uint64_t) (uintptr_t) this
+			^ (uint64_t) std::chrono::steady_clock::now().time_since_epoch().count();
+
+		return true;
+	}
+
+	SQLiteBusyStatistics SQLiteDatabase::get_busy_statistics() const
+	{
+		return SQLiteBusyStatistics
+		{
+			busy_conflicts.load(std::memory_order_relaxed),
+			busy_retries.load(std::memory_order_relaxed),
+			busy_timeouts.load(std::memory_order_relaxed),
+			std::chrono::microseconds(busy_wait_microseconds.load(std::memory_order_relaxed))
+		};
+	}
+
+	void SQLiteDatabase::reset_busy_statistics()
+	{
+		busy_conflicts = 0;
+		busy_retries = 0;
+		busy_timeouts = 0;
+		busy_wait_microseconds = 0;
+	}
+
+	bool SQLiteDatabase::wait_busy(int attempt, std::chrono::steady_clock::time_point since)
+	{
+		using namespace std::chrono;
+
+		const steady_clock::time_point now = steady_clock::now();
+		const microseconds remaining = busy_policy.timeout - duration_cast<microseconds>(now - since);
+
+		if (busy_policy.strategy == SQLiteBusyStrategy::Fail || remaining.count() <= 0)
+		{
+			++busy_timeouts;
+			return false;
+		}
+
+		switch (busy_policy.strategy)
+		{
+		case SQLiteBusyStrategy::Timeout:
+		{
+			// the steps of sqlite3_busy_timeout
+			static constexpr int Delays[] = { 1, 2, 5, 10, 15, 20, 25, 25, 25, 50, 50, 100 };
+			constexpr int Count = sizeof(Delays) / sizeof(*Delays);
+
+			const microseconds delay = milliseconds(Delays[std::min(attempt, Count - 1)]);
+			std::this_thread::sleep_for(std::min(delay, remaining));
+
+			break;
+		}
+		case SQLiteBusyStrategy::Backoff:
+		{
+			const double growth = std::pow(busy_policy.multiplier, attempt);
+			double delay = std::min(
+				busy_policy.initial_delay.count() * growth,
+				(double) busy_policy.max_delay.count());
+
+			// xorshift, a random number for the jitter
+			busy_random ^= busy_random << 13;
+			busy_random ^= busy_random >> 7;
+			busy_random ^= busy_random << 17;
+
+			delay *= 1.0 - busy_policy.jitter * ((busy_random >> 11) * (1.0 / 9007199254740992.0));
+
+			std::this_thread::sleep_for(std::min(microseconds((int64_t) delay), remaining));
+
+			break;
+		}
+		default:
+			std::this_thread::yield();
+
+			break;
+		}
+
+		busy_wait_microseconds += duration_cast<microseconds>(steady_clock::now() - now).count();
+		++busy_retries;
+
+		return true;
+	}
+
+	int SQLiteDatabase::BusyHandler(void* data, int attempt)
+	{
+		SQLiteDatabase* const database = (SQLiteDatabase*) data;
+
+		// sqlite counts the calls of every lock request from zero. the
+		// requests of a retrying statement continue its conflict
+		if (attempt == 0 && !database->busy_retrying)
+		{
+			database->begin_busy_conflict();
+		}
+
+		if (database->wait_busy(attempt, database->busy_since))
+		{
+			return 1;
+		}
+
+		database->busy_timed_out = true;
+		return 0;
+	}
+
+	void SQLiteDatabase::begin_busy_conflict()
+	{
+		busy_since = std::chrono::steady_clock::now();
+		busy_counted = true;
+		busy_timed_out = false;
+
+		++busy_conflicts;
+	}
+
+	bool SQLiteDatabase::open(const std::string& filename, const SQLiteOpenOptions& options)
+	{
+		if (EnsureSQLiteStatusCode(
+				sqlite3_open_v2(
+					filename.c_str(),
+					&database,
+					options.get_flags(),
+					options.vfs.empty() ? NULL : options.vfs.c_str()),
+				filename.c_str()))
+		{
+			if (options.tuning)
+			{
+				tune(*options.tuning);
+			}
+
+			return true;
+		}
+
+		// sqlite allocates a connection even if opening failed
+		sqlite3_close(database);
+		database = NULL;
+
+		return false;
+	}
+
+	sqlite3_stmt* SQLiteStatementCache::checkout(const std::string& query, const void** validated)
+	{
+		auto entry = lookup.find(query);
+
+		if (entry == lookup.end())
+		{
+			++statistics.misses;
+			return NULL;
+		}
+
+		++statistics.hits;
+
+		sqlite3_stmt* statement = entry->second->statement;
+
+		if (validated)
+			*validated = entry->second->validated;
+
+		entries.erase(entry->second);
+		lookup.erase(entry);
+
+		return statement;
+	}
+
+	void SQLiteStatementCache::checkin(const std::string& query, sqlite3_stmt* statement,
+		const void* validated)
+	{
+		// a statement with the same query might have been checked in
+		// while this one was in use. only one of them is kept
+		if (capacity == 0 || lookup.find(query) != lookup.end())
+		{
+			sqlite3_finalize(statement);
+			return;
+		}
+
+		evict(capacity - 1);
+
+		entries.push_front(Entry{ query, statement, validated });
+		lookup.emplace(query, entries.begin());
+	}
+
+	void SQLiteStatementCache::clear()
+	{
+		for (auto& entry : entries)
+		{
+			sqlite3_finalize(entry.statement);
+		}
+
+		entries.clear();
+		lookup.clear();
+	}
+
+	void SQLiteStatementCache::set_capacity(size_t capacity)
+	{
+		this->capacity = capacity;
+		evict(capacity);
+	}
+
+	void SQLiteStatementCache::evict(size_t size)
+	{
+		while (entries.size() > size)
+		{
+			sqlite3_finalize(entries.back().statement);
+
+			lookup.erase(entries.back().query);
+			entries.pop_back();
+
+			++statistics.evictions;
+		}
+	}
+
+	void SQLiteDatabase::set_profiler(SQLiteProfileRegistry* profiler)
+	{
+		// cached statements would carry status counters of executions
+		// before and skip their prepare
+		if (profiler != this->profiler)
+		{
+			statement_cache.clear();
+		}
+
+		this->profiler = profiler;
+	}
+
+	void SQLiteDatabase::set_column_validation(SQLiteColumnValidation validation)
+	{
+		// cached statements were only validated as strict as before
+		if (validation != column_validation)
+		{
+			statement_cache.clear();
+		}
+
+		column_validation = validation;
+	}
+
+	bool SQLiteDeclaredTypeFits(int storage, const char* declared_type)
+	{
+		if (storage == 0 || declared_type == NULL)
+		{
+			return true;
+		}
+
+		std::string type = declared_type;
+
+		for (char& character : type)
+		{
+			character = (char) toupper((unsigned char) character);
+		}
+
+		const auto contains = [&type](const char* part)
+		{
+			return type.find(part) != std::string::npos;
+		};
+
+		// column affinity as determined by sqlite
+		if (contains("INT"))
+		{
+			return storage == SQLITE_INTEGER || storage == SQLITE_FLOAT;
+		}
+
+		if (contains("CHAR") || contains("CLOB") || contains("TEXT"))
+		{
+			// wide strings are stored as blobs in text columns
+			return storage == SQLITE_TEXT || storage == SQLITE_BLOB;
+		}
+
+		if (type.empty())
+		{
+			return true;
+		}
+
+		if (contains("BLOB"))
+		{
+			return storage == SQLITE_BLOB;
+		}
+
+		if (contains("REAL") || contains("FLOA") || contains("DOUB"))
+		{
+			return storage == SQLITE_FLOAT;
+		}
+
+		// numeric affinity
+		return storage == SQLITE_INTEGER || storage == SQLITE_FLOAT;
+	}
+
+	void SQLiteProfileRegistry::record_prepare(const std::string& query, std::chrono::nanoseconds time)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		SQLiteQueryProfile& profile = get_profile(query);
+
+		++profile.prepares;
+		profile.prepare_time += time;
+	}
+
+	void SQLiteProfileRegistry::record_execution(
+		const std::string& query,
+		const SQLiteStatementProfile& execution,
+		sqlite3_stmt* statement)
+	{
+		const auto status = [statement](int counter)
+		{
+			return (uint64_t) sqlite3_stmt_status(statement, counter, 1);
+		};
+
+		// read outside of the lock, the statement belongs to the caller
+		const uint64_t fullscan_steps = status(SQLITE_STMTSTATUS_FULLSCAN_STEP);
+		const uint64_t sorts = status(SQLITE_STMTSTATUS_SORT);
+		const uint64_t autoindexes = status(SQLITE_STMTSTATUS_AUTOINDEX);
+		const uint64_t vm_steps = status(SQLITE_STMTSTATUS_VM_STEP);
+		const uint64_t reprepares = status(SQLITE_STMTSTATUS_REPREPARE);
+		const uint64_t runs = status(SQLITE_STMTSTATUS_RUN);
+
+		std::lock_guard<std::mutex> lock(mutex);
+		SQLiteQueryProfile& profile = get_profile(query);
+
+		++profile.executions;
+		profile.steps += execution.steps;
+		profile.rows += execution.rows;
+		profile.step_time += execution.step_time;
+		profile.max_execution_time = std::max(profile.max_execution_time, execution.step_time);
+
+		profile.fullscan_steps += fullscan_steps;
+		profile.sorts += sorts;
+		profile.autoindexes += autoindexes;
+		profile.vm_steps += vm_steps;
+		profile.reprepares += reprepares;
+		profile.runs += runs;
+	}
+
+	std::vector<std::pair<std::string, SQLiteQueryProfile>> SQLiteProfileRegistry::get_profiles() const
+	{
+		std::vector<std::pair<std::string, SQLiteQueryProfile>> result;
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			result.assign(profiles.begin(), profiles.end());
+		}
+
+		std::sort(result.begin(), result.end(), [](const auto& left, const auto& right)
+			{
+				return left.second.step_time > right.second.step_time;
+			});
+
+		return result;
+	}
+
+	void SQLiteProfileRegistry::clear()
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		normalized.clear();
+		profiles.clear();
+	}
+
+	std::string SQLiteProfileRegistry::to_json() const
+	{
+		const auto escape = [](const std::string& text)
+		{
+			std::string result;
+			result.reserve(text.size());
+
+			for (const char character : text)
+			{
+				switch (character)
+				{
+				case '"':
+					result += "\\\"";
+
+					break;
+				case '\\':
+					result += "\\\\";
+
+					break;
+				case '\n':
+					result += "\\n";
+
+					break;
+				case '\t':
+					result += "\\t";
+
+					break;
+				default:
+					if ((unsigned char) character < 0x20)
+					{
+						char buffer[8];
+						std::snprintf(buffer, sizeof(buffer), "\\u%04x", character);
+						result += buffer;
+					}
+					else
+					{
+						result += character;
+					}
+
+					break;
+				}
+			}
+
+			return result;
+		};
+
+		std::string json = "[";
+		bool first = true;
+
+		for (const auto& [query, profile] : get_profiles())
+		{
+			json += first ? "\n" : ",\n";
+			first = false;
+
+			json += "  {\"query\": \"" + escape(query) + "\""
+				+ ", \"prepares\": " + std::to_string(profile.prepares)
+				+ ", \"prepare_time_ns\": " + std::to_string(profile.prepare_time.count())
+				+ ", \"executions\": " + std::to_string(profile.executions)
+				+ ", \"steps\": " + std::to_string(profile.steps)
+				+ ", \"rows\": " + std::to_string(profile.rows)
+				+ ", \"step_time_ns\": " + std::to_string(profile.step_time.count())
+				+ ", \"max_execution_time_ns\": " + std::to_string(profile.max_execution_time.count())
+				+ ", \"fullscan_steps\": " + std::to_string(profile.fullscan_steps)
+				+ ", \"sorts\": " + std::to_string(profile.sorts)
+				+ ", \"autoindexes\": " + std::to_string(profile.autoindexes)
+				+ ", \"vm_steps\": " + std::to_string(profile.vm_steps)
+				+ ", \"reprepares\": " + std::to_string(profile.reprepares)
+				+ ", \"runs\": " + std::to_string(profile.runs)
+				+ "}";
+		}
+
+		json += first ? "]" : "\n]";
+		return json;
+	}
+
+	std::string SQLiteProfileRegistry::Normalize(std::string_view query)
+	{
+		std::string result;
+		result.reserve(query.size());
+
+		const auto is_identifier = [](char character)
+		{
+			return std::isalnum((unsigned char) character) || character == '_' || character == '$';
+		};
+
+		// skips a quoted section and returns the position after it
+		const auto skip_quoted = [&query](size_t position, char end)
+		{
+			for (++position; position < query.size(); ++position)
+			{
+				if (query[position] == end)
+				{
+					// doubled quotes are escaped quotes
+					if (position + 1 < query.size() && query[position + 1] == end && end != ']')
+					{
+						++position;
+						continue;
+					}
+
+					return position + 1;
+				}
+			}
+
+			return query.size();
+		};
+
+		const auto add_space = [&result]()
+		{
+			if (!result.empty() && result.back() != ' ')
+				result += ' ';
+		};
+
+		size_t position = 0;
+
+		while (position < query.size())
+		{
+			const char character = query[position];
+
+			if (std::isspace((unsigned char) character))
+			{
+				add_space();
+				++position;
+			}
+			else if (character == '-' && query.substr(position, 2) == "--")
+			{
+				const size_t end = query.find('\n', position);
+				position = end == std::string_view::npos ? query.size() : end;
+			}
+			else if (character == '/' && query.substr(position, 2) == "/*")
+			{
+				const size_t end = query.find("*/", position + 2);
+				position = end == std::string_view::npos ? query.size() : end + 2;
+				add_space();
+			}
+			else if (character == '\'')
+			{
+				result += '?';
+				position = skip_quoted(position, '\'');
+			}
+			else if ((character == 'x' || character == 'X')
+				&& position + 1 < query.size() && query[position + 1] == '\''
+				&& (result.empty() || !is_identifier(result.back())))
+			{
+				// blob literal
+				result += '?';
+				position = skip_quoted(position + 1, '\'');
+			}
+			else if (character == '"' || character == '`' || character == '[')
+			{
+				// quoted identifiers stay
+				const size_t end = skip_quoted(position, character == '[' ? ']' : character);
+				result.append(query.substr(position, end - position));
+				position = end;
+			}
+			else if ((std::isdigit((unsigned char) character)
+					|| (character == '.' && position + 1 < query.size()
+						&& std::isdigit((unsigned char) query[position + 1])))
+				&& (result.empty() || !is_identifier(result.back())))
+			{
+				// numbers, including hex and exponents
+				result += '?';
+
+				while (position < query.size()
+					&& (is_identifier(query[position]) || query[position] == '.'
+						|| ((query[position] == '+' || query[position] == '-')
+							&& (query[position - 1] == 'e' || query[position - 1] == 'E'))))
+				{
+					++position;
+				}
+			}
+			else
+			{
+				result += character;
+				++position;
+			}
+		}
+
+		while (!result.empty() && (result.back() == ' ' || result.back() == ';'))
+		{
+			result.pop_back();
+		}
+
+		return result;
+	}
+
+	SQLiteQueryProfile& SQLiteProfileRegistry::get_profile(const std::string& query)
+	{
+		auto entry = normalized.find(query);
+
+		if (entry == normalized.end())
+		{
+			entry = normalized.emplace(query, Normalize(query)).first;
+		}
+
+		return profiles[entry->second];
+	}
+
+	bool SQLiteDatabase::enable_trace(const SQLiteTraceOptions& options)
+	{
+		auto log = std::make_unique<SQLiteTraceLog>(options);
+
+		const unsigned int mask = SQLITE_TRACE_STMT | SQLITE_TRACE_PROFILE
+			| (options.count_rows ? SQLITE_TRACE_ROW : 0);
+
+		if (!EnsureSQLiteStatusCode(
+				sqlite3_trace_v2(database, mask, &SQLiteTraceLog::Callback, log.get()),
+				"failed to enable trace"))
+		{
+			return false;
+		}
+
+		trace_log = std::move(log);
+		return true;
+	}
+
+	bool SQLiteDatabase::disable_trace()
+	{
+		if (!EnsureSQLiteStatusCode(
+				sqlite3_trace_v2(database, 0, NULL, NULL),
+				"failed to disable trace"))
+		{
+			return false;
+		}
+
+		trace_log.reset();
+		return true;
+	}
+
+	SQLiteTraceLog::SQLiteTraceLog(const SQLiteTraceOptions& options)
+		:
+		options(options)
+	{
+		this->options.sample_every = std::max<uint32_t>(options.sample_every, 1);
+		this->options.capacity = std::max<size_t>(options.capacity, 1);
+
+		entries.reserve(this->options.capacity);
+	}
+
+	std::vector<SQLiteTraceEntry> SQLiteTraceLog::get_entries() const
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		// the oldest entry is the next to override
+		std::vector<SQLiteTraceEntry> result(entries.begin() + next, entries.end());
+		result.insert(result.end(), entries.begin(), entries.begin() + next);
+
+		return result;
+	}
+
+	void SQLiteTraceLog::clear()
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		entries.clear();
+		next = 0;
+	}
+
+	int SQLiteTraceLog::Callback(unsigned int event, void* data, void* first, void* second)
+	{
+		SQLiteTraceLog* const log = (SQLiteTraceLog*) data;
+		sqlite3_stmt* const statement = (sqlite3_stmt*) first;
+
+		switch (event)
+		{
+		case SQLITE_TRACE_STMT:
+		{
+			// triggers report their start as "-- trigger" text
+			if (std::strncmp((const char*) second, "--", 2) == 0)
+			{
+				break;
+			}
+
+			const auto entry = log->find_running(statement);
+
+			if (entry != log->running.end())
+			{
+				entry->second = 0;
+			}
+			else
+			{
+				log->running.emplace_back(statement, 0);
+			}
+
+			break;
+		}
+		case SQLITE_TRACE_ROW:
+		{
+			const auto entry = log->find_running(statement);
+
+			if (entry != log->running.end())
+			{
+				++entry->second;
+			}
+
+			break;
+		}
+		case SQLITE_TRACE_PROFILE:
+			log->record(statement, std::chrono::nanoseconds(*(const sqlite3_int64*) second));
+
+			break;
+		}
+
+		return 0;
+	}
+
+	SQLiteTraceLog::Running::iterator SQLiteTraceLog::find_running(sqlite3_stmt* statement)
+	{
+		return std::find_if(running.begin(), running.end(), [statement](const auto& entry)
+			{
+				return entry.first == statement;
+			});
+	}
+
+	void SQLiteTraceLog::record(sqlite3_stmt* statement, std::chrono::nanoseconds duration)
+	{
+		uint64_t rows = 0;
+
+		if (const auto entry = find_running(statement); entry != running.end())
+		{
+			rows = entry->second;
+
+			*entry = running.back();
+			running.pop_back();
+		}
+
+		if (duration < options.threshold || slow_statements++ % options.sample_every != 0)
+		{
+			return;
+		}
+
+		SQLiteTraceEntry entry;
+
+		entry.duration = duration;
+		entry.rows = rows;
+		entry.time = std::chrono::system_clock::now();
+
+		if (char* expanded = options.expand_sql ? sqlite3_expanded_sql(statement) : NULL)
+		{
+			entry.sql = expanded;
+			sqlite3_free(expanded);
+		}
+		else
+		{
+			entry.sql = sqlite3_sql(statement);
+		}
+
+		if (options.on_entry)
+		{
+			options.on_entry(entry);
+		}
+
+		std::unique_lock<std::mutex> lock(mutex, std::try_to_lock);
+
+		if (!lock)
+		{
+			++dropped;
+			return;
+		}
+
+		if (entries.size() < options.capacity)
+		{
+			entries.push_back(std::move(entry));
+		}
+		else
+		{
+			entries[next] = std::move(entry);
+			next = (next + 1) % options.capacity;
+		}
+	}
+
+	SQLiteTransaction::SQLiteTransaction(SQLiteDatabase* database, SQLiteTransactionMode mode)
+		:
+		database(database),
+		active(false)
+	{
+		const char* query;
+
+		switch (mode)
+		{
+		case SQLiteTransactionMode::Immediate:
+			query = "BEGIN IMMEDIATE";
+
+			break;
+		case SQLiteTransactionMode::Exclusive:
+			query = "BEGIN EXCLUSIVE";
+
+			break;
+		default:
+			query = "BEGIN DEFERRED";
+
+			break;
+		}
+
+		// transaction statements are reused through the statement cache
+		active = SQLiteStatement<>(database, query).execute();
+	}
+
+	bool SQLiteTransaction::commit()
+	{
+		if (!active)
+		{
+			if (OnDatabaseCoreFailure)
+				OnDatabaseCoreFailure("tried to commit inactive transaction");
+
+			return false;
+		}
+
+		if (SQLiteStatement<>(database, "COMMIT").execute())
+		{
+			active = false;
+			return true;
+		}
+
+		// some errors roll back the transaction automatically
+		active = sqlite3_get_autocommit(database->get_database()) == 0;
+		return false;
+	}
+
+	bool SQLiteTransaction::rollback()
+	{
+		if (!active)
+		{
+			if (OnDatabaseCoreFailure)
+				OnDatabaseCoreFailure("tried to rollback inactive transaction");
+
+			return false;
+		}
+
+		active = false;
+
+		// rollback fails if sqlite already rolled back the transaction
+		return sqlite3_get_autocommit(database->get_database()) != 0
+			|| SQLiteStatement<>(database, "ROLLBACK").execute();
+	}
+
+	SQLiteSavepoint::SQLiteSavepoint(SQLiteDatabase* database)
+		:
+		database(database),
+		depth(database->savepoint_depth),
+		active(false)
+	{
+		active = SQLiteStatement<>(database, "SAVEPOINT " + name()).execute();
+
+		if (active)
+			++database->savepoint_depth;
+	}
+
+	bool SQLiteSavepoint::commit()
+	{
+		if (!active)
+		{
+			if (OnDatabaseCoreFailure)
+				OnDatabaseCoreFailure("tried to release inactive savepoint");
+
+			return false;
+		}
+
+		assert(depth + 1 == database->savepoint_depth);
+
+		if (!SQLiteStatement<>(database, "RELEASE " + name()).execute())
+		{
+			return false;
+		}
+
+		active = false;
+		--database->savepoint_depth;
+
+		return true;
+	}
+
+	bool SQLiteSavepoint::rollback()
+	{
+		if (!active)
+		{
+			if (OnDatabaseCoreFailure)
+				OnDatabaseCoreFailure("tried to rollback inactive savepoint");
+
+			return false;
+		}
+
+		assert(depth + 1 == database->savepoint_depth);
+
+		active = false;
+		--database->savepoint_depth;
+
+		// rollback to keeps the savepoint open
+		return SQLiteStatement<>(database, "ROLLBACK TO " + name()).execute()
+			&& SQLiteStatement<>(database, "RELEASE " + name()).execute();
+	}
+
+	std::string SQLiteSavepoint::name() const
+	{
+		// names only depend on the depth, so their statements are reused
+		return "databasecore_" + std::to_string(depth);
+	}
 }
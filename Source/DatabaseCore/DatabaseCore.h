@@ -2,12 +2,26 @@
 
 #include "sqlite3.h"
 
+#include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
 #include <functional>
+#include <iterator>
+#include <list>
+#include <memory>
+#include <mutex>
 #include <optional>
+#include <stdexcept>
 #include <string>
+#include <string_view>
 #include <tuple>
 #include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <variant>
 #include <vector>
 
 #pragma comment(lib, "sqlite3.lib")
@@ -21,458 +35,1899 @@ namespace Database
 	typedef std::string					SQLiteString; // char*
 	typedef std::vector<unsigned char>	SQLiteBlob;   // unsigned char*
 
-	extern std::function<void(const char*)> OnDatabaseCoreFailure;
-	extern std::function<void(int, const char*)> OnSQLiteFailure;
-	bool EnsureSQLiteStatusCode(int status_code, const char* message);
+	// views point directly into the column buffer of the statement and
+	// are only valid until it is stepped, reset or destroyed
+	typedef std::string_view			SQLiteStringView;
 
-	class SQLiteDatabase
+	class SQLiteBlobView
 	{
 	public:
-		SQLiteDatabase(std::string filename)
+		typedef const unsigned char* const_iterator;
+
+		SQLiteBlobView() = default;
+		SQLiteBlobView(const unsigned char* data, size_t size)
+			:
+			data_(data),
+			size_(size)
 		{
-			open(filename);
 		}
 
-		~SQLiteDatabase()
+		SQLiteBlobView(const SQLiteBlob& blob)
+			:
+			SQLiteBlobView(blob.data(), blob.size())
 		{
-			// null is a noop
-			sqlite3_close(database);
 		}
 
-		operator bool()
+		const unsigned char* data() const
 		{
-			return database != NULL;
+			return data_;
 		}
 
-		std::string last_error_message() const
+		size_t size() const
 		{
-			return sqlite3_errmsg(database);
+			return size_;
 		}
 
-		int last_error_code() const
+		bool empty() const
 		{
-			return sqlite3_errcode(database);
+			return size_ == 0;
 		}
 
-		sqlite3* get_database() const
+		const_iterator begin() const
 		{
-			return database;
+			return data_;
 		}
 
-	private:
-		sqlite3* database;
+		const_iterator end() const
+		{
+			return data_ + size_;
+		}
+
+		unsigned char operator[](size_t index) const
+		{
+			assert(index < size_);
+			return data_[index];
+		}
 
-		bool open(std::string filename)
+		SQLiteBlob to_blob() const
 		{
-			return EnsureSQLiteStatusCode(
-				sqlite3_open(filename.c_str(), &database),
-				filename.c_str());
+			return SQLiteBlob(begin(), end());
 		}
+
+	private:
+		const unsigned char* data_ = NULL;
+		size_t size_ = 0;
 	};
 
-	template <typename T, typename Lazy = void>
-	struct SQLiteStatementColumn
+	// binds a caller owned text or blob with SQLITE_STATIC, so sqlite
+	// does not copy it. the value has to stay alive and unchanged until
+	// it is rebound, the bindings are cleared or the statement is
+	// destroyed. reset does not release bindings
+	template <typename T>
+	struct SQLiteStatic
 	{
+		const T* value;
 	};
 
-	template <typename T, typename Lazy>
-	struct SQLiteStatementColumn<::std::optional<T>, Lazy>
+	template <typename T>
+	SQLiteStatic<T> Borrowed(const T& value)
 	{
-		template <typename Tuple, size_t Column = 0>
-		static inline void Extract(Tuple& tuple, sqlite3_stmt* statement)
+		return SQLiteStatic<T>{ &value };
+	}
+
+	// a temporary would be destroyed before the statement runs
+	template <typename T>
+	void Borrowed(const T&&) = delete;
+
+	// binds a blob of size zero bytes without a buffer. its content is
+	// written afterwards with SQLiteBlobStream
+	struct SQLiteZeroBlob
+	{
+		SQLiteInt size;
+	};
+
+	// returned by SQLiteCountPlaceholders for queries with numbered or
+	// named parameters, which can not be counted
+	constexpr size_t SQLiteUncountedPlaceholders = size_t(-1);
+
+	// counts ? placeholders outside of literals, quoted names and comments
+	constexpr size_t SQLiteCountPlaceholders(const char* query)
+	{
+		size_t count = 0;
+
+		for (size_t i = 0; query[i] != '\0'; ++i)
 		{
-			if (sqlite3_column_type(statement, Column) == SQLITE_NULL)
+			const char character = query[i];
+
+			if (character == '\'' || character == '"' || character == '`' || character == '[')
 			{
-				std::get<Column>(tuple).reset();
+				// a doubled quote ends and reopens the literal
+				const char close = character == '[' ? ']' : character;
+
+				do
+				{
+					++i;
+				}
+				while (query[i] != '\0' && query[i] != close);
+
+				if (query[i] == '\0')
+					break;
 			}
-			else
+			else if (character == '-' && query[i + 1] == '-')
 			{
-				SQLiteStatementColumn<T>::template ExtractAs<Tuple, Column>(
-					*std::get<Column>(tuple), statement);
+				while (query[i + 1] != '\0' && query[i + 1] != '\n')
+					++i;
 			}
-		}
+			else if (character == '/' && query[i + 1] == '*')
+			{
+				for (i += 2; query[i] != '\0' && !(query[i] == '*' && query[i + 1] == '/'); ++i);
 
-		template <typename Tuple, size_t Column = 0>
-		static inline int Bind(Tuple& tuple, sqlite3_stmt* statement)
-		{
-			if (std::get<Column>(tuple))
+				if (query[i] == '\0')
+					break;
+
+				++i;
+			}
+			else if (character == '?')
 			{
-				return SQLiteStatementColumn<T>::template BindAs(
-					*std::get<Column>(tuple), Column, statement);
+				if (query[i + 1] >= '0' && query[i + 1] <= '9')
+					return SQLiteUncountedPlaceholders;
+
+				++count;
 			}
-			else
+			else if (character == ':' || character == '@' || character == '$')
 			{
-				return sqlite3_bind_null(statement, Column + 1);
+				return SQLiteUncountedPlaceholders;
 			}
 		}
-	};
 
-	template <typename Lazy>
-	struct SQLiteStatementColumn<std::nullopt_t, Lazy>
+		return count;
+	}
+
+	// sql text carrying its number of placeholders in its type, so a
+	// statement can check its bind arguments at compile time. created
+	// with DATABASECORE_QUERY("...")
+	template <size_t Placeholders>
+	struct SQLiteQuery
 	{
-		template <typename Tuple, size_t Column = 0>
-		static inline int Bind(Tuple& tuple, sqlite3_stmt* statement)
-		{
-			return sqlite3_bind_null(statement, Column + 1);
-		}
+		static constexpr size_t PlaceholderCount = Placeholders;
+
+		const char* text;
 	};
 
-	template <typename T>
-	struct SQLiteStatementColumn<T, std::enable_if_t<std::is_integral_v<T>>>
+#define DATABASECORE_QUERY(query) \
+	::Database::SQLiteQuery<::Database::SQLiteCountPlaceholders(query)>{ query }
+
+	extern std::function<void(const char*)> OnDatabaseCoreFailure;
+	extern std::function<void(int, const char*)> OnSQLiteFailure;
+	bool EnsureSQLiteStatusCode(int status_code, const char* message);
+
+	// thrown by SQLiteErrorPolicy::Throw
+	class SQLiteException
+		:
+		public std::runtime_error
 	{
-		template <typename Tuple, size_t Column = 0>
-		static inline void Extract(Tuple& tuple, sqlite3_stmt* statement)
+	public:
+		SQLiteException(int code, const char* message)
+			:
+			std::runtime_error(std::string(message) + ": " + sqlite3_errstr(code)),
+			code(code)
 		{
-			ExtractAs<Column>((SQLiteInt&)std::get<Column>(tuple), statement);
 		}
 
-		template <size_t Column = 0>
-		static inline void ExtractAs(SQLiteInt& value, sqlite3_stmt* statement)
+		// SQLITE_MISUSE if databasecore itself was misused
+		int get_code() const
 		{
-			assert(sqlite3_column_type(statement, Column) != SQLITE_NULL);
-			value = sqlite3_column_int64(statement, Column);
+			return code;
 		}
 
-		template <typename Tuple, size_t Column = 0>
-		static inline int Bind(Tuple& tuple, sqlite3_stmt* statement)
+	private:
+		int code;
+	};
+
+	// decides at compile time how a statement reports failures. Check
+	// gets every sqlite result code that is not SQLITE_OK, Report every
+	// misuse of the statement
+	namespace SQLiteErrorPolicy
+	{
+		// reports through OnSQLiteFailure and OnDatabaseCoreFailure
+		struct Callback
 		{
-			return BindAs((SQLiteInt)std::get<Column>(tuple), Column, statement);
-		}
+			static bool Check(int code, const char* message)
+			{
+				return EnsureSQLiteStatusCode(code, message);
+			}
 
-		static inline int BindAs(SQLiteInt value, size_t Column, sqlite3_stmt* statement)
+			static void Report(const char* message)
+			{
+				if (OnDatabaseCoreFailure)
+					OnDatabaseCoreFailure(message);
+			}
+		};
+
+		// failures still fail the statement, but are not reported
+		struct NoCheck
 		{
-			return sqlite3_bind_int64(statement, Column + 1, value);
-		}
+			static bool Check(int, const char*)
+			{
+				return false;
+			}
+
+			static void Report(const char*)
+			{
+			}
+		};
+
+		// throws SQLiteException
+		struct Throw
+		{
+			static bool Check(int code, const char* message)
+			{
+				throw SQLiteException(code, message);
+			}
+
+			static void Report(const char* message)
+			{
+				throw SQLiteException(SQLITE_MISUSE, message);
+			}
+		};
+	}
+
+	struct SQLiteError
+	{
+		int code;
+		std::string message;
 	};
 
+	// either a value or the error that prevented it, like std::expected
 	template <typename T>
-	struct SQLiteStatementColumn<T, std::enable_if_t<std::is_floating_point_v<T>>>
+	class SQLiteResult
 	{
-		template <typename Tuple, size_t Column = 0>
-		static inline void Extract(Tuple& tuple, sqlite3_stmt* statement)
+	public:
+		SQLiteResult(T value)
+			:
+			content(std::in_place_index<0>, std::move(value))
 		{
-			ExtractAs<Column>((SQLiteReal&)std::get<Column>(tuple), statement);
 		}
 
-		template <size_t Column = 0>
-		static inline void ExtractAs(SQLiteReal& value, sqlite3_stmt* statement)
+		SQLiteResult(SQLiteError error)
+			:
+			content(std::in_place_index<1>, std::move(error))
 		{
-			assert(sqlite3_column_type(statement, Column) != SQLITE_NULL);
-			value = sqlite3_column_double(statement, Column);
 		}
 
-		template <typename Tuple, size_t Column = 0>
-		static inline int Bind(Tuple& tuple, sqlite3_stmt* statement)
+		bool has_value() const
 		{
-			return BindAs((SQLiteReal)std::get<Column>(tuple), Column, statement);
+			return content.index() == 0;
 		}
 
-		static inline int BindAs(SQLiteReal value, size_t Column, sqlite3_stmt* statement)
+		explicit operator bool() const
 		{
-			return sqlite3_bind_double(statement, Column + 1, value);
+			return has_value();
 		}
-	};
 
-	template <typename Lazy>
-	struct SQLiteStatementColumn<SQLiteString, Lazy>
-	{
-		template <typename Tuple, size_t Column = 0>
-		static inline void Extract(Tuple& tuple, sqlite3_stmt* statement)
+		T& value() &
 		{
-			ExtractAs<Column>(std::get<Column>(tuple), statement);
+			assert(has_value());
+			return std::get<0>(content);
 		}
 
-		template <size_t Column = 0>
-		static inline void ExtractAs(SQLiteString& value, sqlite3_stmt* statement)
+		const T& value() const&
 		{
-			assert(sqlite3_column_type(statement, Column) != SQLITE_NULL);
-			value.assign((const char*)sqlite3_column_text(statement, Column));
+			assert(has_value());
+			return std::get<0>(content);
 		}
 
-		template <typename Tuple, size_t Column = 0>
-		static inline int Bind(Tuple& tuple, sqlite3_stmt* statement)
+		T&& value() &&
 		{
-			return BindAs(std::get<Column>(tuple), Column, statement);
+			assert(has_value());
+			return std::get<0>(std::move(content));
 		}
 
-		static inline int BindAs(SQLiteString& value, size_t Column, sqlite3_stmt* statement)
+		T& operator*() &
 		{
-			return sqlite3_bind_text(
-				statement, Column + 1, value.c_str(),
-				value.size(),
-				SQLITE_TRANSIENT);
+			return value();
 		}
-	};
 
-	template <typename Lazy>
-	struct SQLiteStatementColumn<const char*, Lazy>
-	{
-		template <typename Tuple, size_t Column = 0>
-		static inline int Bind(Tuple& tuple, sqlite3_stmt* statement)
+		const T& operator*() const&
 		{
-			return BindAs(std::get<Column>(tuple), Column, statement);
+			return value();
 		}
 
-		static inline int BindAs(const char* value, size_t Column, sqlite3_stmt* statement)
+		T* operator->()
 		{
-			return sqlite3_bind_text(
-				statement,
-				Column + 1, value,
-				-1,
-				SQLITE_TRANSIENT);
+			return &value();
 		}
-	};
 
-	template <typename Lazy>
-	struct SQLiteStatementColumn<char*, Lazy>
-		:
-		public SQLiteStatementColumn<const char*>
-	{
-		template <typename Tuple, size_t Column = 0>
-		static inline void Extract(Tuple& tuple, sqlite3_stmt* statement)
+		const T* operator->() const
 		{
-			ExtractAs<Column>(std::get<Column>(tuple), statement);
+			return &value();
 		}
 
-		template <size_t Column = 0>
-		static inline void ExtractAs(char* value, sqlite3_stmt* statement)
+		template <typename U>
+		T value_or(U&& fallback) const&
 		{
-			assert(sqlite3_column_type(statement, Column) != SQLITE_NULL);
-			memcpy(value,
-				(const void*)sqlite3_column_text(statement, Column),
-				sqlite3_column_bytes(statement, Column));
+			return has_value() ? value() : static_cast<T>(std::forward<U>(fallback));
 		}
+
+		const SQLiteError& error() const
+		{
+			assert(!has_value());
+			return std::get<1>(content);
+		}
+
+	private:
+		std::variant<T, SQLiteError> content;
 	};
 
-	template <typename Lazy>
-	struct SQLiteStatementColumn<SQLiteBlob, Lazy>
+	template <>
+	class SQLiteResult<void>
 	{
-		template <typename Tuple, size_t Column = 0>
-		static inline void Extract(Tuple& tuple, sqlite3_stmt* statement)
+	public:
+		SQLiteResult() = default;
+
+		SQLiteResult(SQLiteError error)
+			:
+			failure(std::move(error))
 		{
-			ExtractAs<Column>(std::get<Column>(tuple), statement);
 		}
 
-		template <size_t Column = 0>
-		static inline void ExtractAs(SQLiteBlob& value, sqlite3_stmt* statement)
+		bool has_value() const
 		{
-			assert(sqlite3_column_type(statement, Column) != SQLITE_NULL);
-			const char* data = (const char*)sqlite3_column_blob(statement, Column);
-			value.assign(data, data + sqlite3_column_bytes(statement, Column));
+			return !failure.has_value();
 		}
 
-		template <typename Tuple, size_t Column = 0>
-		static inline int Bind(Tuple& tuple, sqlite3_stmt* statement)
+		explicit operator bool() const
 		{
-			return BindAs(std::get<Column>(tuple), Column, statement);
+			return has_value();
 		}
 
-		static inline int BindAs(SQLiteBlob& value, size_t Column, sqlite3_stmt* statement)
+		const SQLiteError& error() const
 		{
-			return sqlite3_bind_blob(
-				statement, Column + 1,
-				(const void*)&value[0],
-				value.size(),
-				SQLITE_TRANSIENT);
+			assert(!has_value());
+			return *failure;
 		}
+
+	private:
+		std::optional<SQLiteError> failure;
 	};
 
-	template <typename Lazy>
-	struct SQLiteStatementColumn<const unsigned char*, Lazy>
+	struct SQLiteStatementCacheStatistics
 	{
-		template <typename Tuple, size_t Column = 0>
-		static inline int Bind(Tuple& tuple, sqlite3_stmt* statement)
-		{
-			return BindAs(std::get<Column>(tuple), Column, statement);
-		}
-
-		static inline int BindAs(const unsigned char* value, size_t Column, sqlite3_stmt* statement)
-		{
-			return sqlite3_bind_blob(
-				statement,
-				Column + 1, (const void*)value,
-				strlen((const char*)value),
-				SQLITE_TRANSIENT);
-		}
+		size_t hits = 0;
+		size_t misses = 0;
+		size_t evictions = 0;
 	};
 
-	template <typename Lazy>
-	struct SQLiteStatementColumn<unsigned char*, Lazy>
-		:
-		public SQLiteStatementColumn<const unsigned char*>
+	// least recently used cache of prepared statements keyed by their
+	// sql text. statements are checked out while in use, so two live
+	// statements never share one sqlite3_stmt
+	class SQLiteStatementCache
 	{
-		template <typename Tuple, size_t Column = 0>
-		static inline void Extract(Tuple& tuple, sqlite3_stmt* statement)
+	public:
+		SQLiteStatementCache(size_t capacity)
+			:
+			capacity(capacity)
 		{
-			ExtractAs<Column>(std::get<Column>(tuple), statement);
 		}
 
-		template <size_t Column = 0>
-		static inline void ExtractAs(unsigned char* value, sqlite3_stmt* statement)
+		~SQLiteStatementCache()
 		{
-			assert(sqlite3_column_type(statement, Column) != SQLITE_NULL);
-			memcpy(value,
-				sqlite3_column_blob(statement, Column),
-				sqlite3_column_bytes(statement, Column));
+			clear();
 		}
-	};
 
-	template <typename Lazy>
-	struct SQLiteStatementColumn<const void*, Lazy>
-	{
-		template <typename Tuple, size_t Column = 0>
-		static inline int Bind(Tuple& tuple, sqlite3_stmt* statement)
-		{
-			return BindAs(std::get<Column>(tuple), Column, statement);
-		}
+		SQLiteStatementCache(const SQLiteStatementCache&) = delete;
+		SQLiteStatementCache& operator=(const SQLiteStatementCache&) = delete;
 
-		static inline int BindAs(const void* value, size_t Column, sqlite3_stmt* statement)
+		// returns null if no prepared statement is cached for query.
+		// validated is set to the tag the statement was checked in with
+		sqlite3_stmt* checkout(const std::string& query, const void** validated = NULL);
+		// expects statement to be reset with cleared bindings. takes
+		// ownership and finalizes statement if it can not be cached.
+		// validated identifies the row type whose columns were checked
+		// against statement, null if none were
+		void checkin(const std::string& query, sqlite3_stmt* statement,
+			const void* validated = NULL);
+
+		void clear();
+
+		void set_capacity(size_t capacity);
+
+		size_t get_capacity() const
 		{
-			return SQLiteStatementColumn<const unsigned char*>::BindAs((const char*)value, Column, statement);
+			return capacity;
 		}
-	};
 
-	template <typename Lazy>
-	struct SQLiteStatementColumn<void*, Lazy>
-		:
-		public SQLiteStatementColumn<const void*>
-	{
-		template <typename Tuple, size_t Column = 0>
-		static inline void Extract(Tuple& tuple, sqlite3_stmt* statement)
+		size_t get_size() const
 		{
-			ExtractAs<Column>(std::get<Column>(tuple), statement);
+			return entries.size();
 		}
 
-		template <size_t Column = 0>
-		static inline void ExtractAs(void* value, sqlite3_stmt* statement)
+		const SQLiteStatementCacheStatistics& get_statistics() const
 		{
-			SQLiteStatementColumn<unsigned char*>::ExtractAs((unsigned char*)value, statement);
+			return statistics;
 		}
-	};
+
+	private:
+		struct Entry
+		{
+			std::string query;
+			sqlite3_stmt* statement;
+			const void* validated;
+		};
+
+		typedef std::list<Entry> Entries;
+
+		size_t capacity;
+		SQLiteStatementCacheStatistics statistics;
+
+		// front is most recently used
+		Entries entries;
+		std::unordered_map<std::string, Entries::iterator> lookup;
+
+		void evict(size_t size);
+	};
+
+	// aggregated over every execution of one normalized query
+	struct SQLiteQueryProfile
+	{
+		uint64_t prepares = 0;
+		std::chrono::nanoseconds prepare_time{ 0 };
+
+		// an execution lasts from the first step until reset or
+		// destruction of the statement
+		uint64_t executions = 0;
+		uint64_t steps = 0;
+		uint64_t rows = 0;
+		std::chrono::nanoseconds step_time{ 0 };
+		std::chrono::nanoseconds max_execution_time{ 0 };
+
+		// sqlite3_stmt_status counters
+		uint64_t fullscan_steps = 0;
+		uint64_t sorts = 0;
+		uint64_t autoindexes = 0;
+		uint64_t vm_steps = 0;
+		uint64_t reprepares = 0;
+		uint64_t runs = 0;
+	};
+
+	// one execution, collected by the statement without locking
+	struct SQLiteStatementProfile
+	{
+		uint64_t steps = 0;
+		uint64_t rows = 0;
+		std::chrono::nanoseconds step_time{ 0 };
+	};
+
+	// collects the profiles of every statement of the connections it is
+	// set on with SQLiteDatabase::set_profiler. can be shared between
+	// connections of different threads
+	class SQLiteProfileRegistry
+	{
+	public:
+		void record_prepare(const std::string& query, std::chrono::nanoseconds time);
+		// reads and resets the sqlite3_stmt_status counters of statement
+		void record_execution(const std::string& query,
+			const SQLiteStatementProfile& profile,
+			sqlite3_stmt* statement);
+
+		// ordered by step time, slowest first
+		std::vector<std::pair<std::string, SQLiteQueryProfile>> get_profiles() const;
+		void clear();
+
+		// array of one object per normalized query
+		std::string to_json() const;
+
+		// collapses whitespace, drops comments and replaces literals with
+		// ?, so queries differing only in literals share one profile
+		static std::string Normalize(std::string_view query);
+
+	private:
+		mutable std::mutex mutex;
+
+		// raw query to normalized query, to normalize every query once
+		std::unordered_map<std::string, std::string> normalized;
+		std::unordered_map<std::string, SQLiteQueryProfile> profiles;
+
+		SQLiteQueryProfile& get_profile(const std::string& query);
+	};
+
+	struct SQLiteTraceEntry
+	{
+		// with bound parameters if expand_sql is set
+		std::string sql;
+		std::chrono::nanoseconds duration;
+		// zero if rows are not counted
+		uint64_t rows;
+		std::chrono::system_clock::time_point time;
+	};
+
+	struct SQLiteTraceOptions
+	{
+		// faster statements are not logged. sqlite measures durations
+		// with millisecond resolution only
+		std::chrono::microseconds threshold{ 100000 };
+		// logs every nth statement above the threshold
+		uint32_t sample_every = 1;
+		// oldest entries are overridden once the log is full
+		size_t capacity = 256;
+
+		// allocates the sql with its parameters for every logged statement
+		bool expand_sql = true;
+		// adds a callback per returned row
+		bool count_rows = true;
+
+		// called on the thread of the connection for every logged entry
+		std::function<void(const SQLiteTraceEntry&)> on_entry;
+	};
+
+	// slow query log filled through sqlite3_trace_v2. the connection
+	// never waits for the log. entries are dropped instead while another
+	// thread reads it
+	class SQLiteTraceLog
+	{
+	public:
+		SQLiteTraceLog(const SQLiteTraceOptions& options);
+
+		SQLiteTraceLog(const SQLiteTraceLog&) = delete;
+		SQLiteTraceLog& operator=(const SQLiteTraceLog&) = delete;
+
+		// oldest first
+		std::vector<SQLiteTraceEntry> get_entries() const;
+		void clear();
+
+		// entries lost because the log was locked
+		uint64_t get_dropped() const
+		{
+			return dropped.load(std::memory_order_relaxed);
+		}
+
+		const SQLiteTraceOptions& get_options() const
+		{
+			return options;
+		}
+
+		static int Callback(unsigned int event, void* data, void* first, void* second);
+
+	private:
+		SQLiteTraceOptions options;
+
+		// statements currently running with their number of rows. only
+		// a few statements of one connection run at the same time
+		typedef std::vector<std::pair<sqlite3_stmt*, uint64_t>> Running;
+
+		Running running;
+		uint64_t slow_statements = 0;
+
+		mutable std::mutex mutex;
+		std::vector<SQLiteTraceEntry> entries;
+		// next entry to override once the log is full
+		size_t next = 0;
+
+		std::atomic<uint64_t> dropped{ 0 };
+
+		Running::iterator find_running(sqlite3_stmt* statement);
+		void record(sqlite3_stmt* statement, std::chrono::nanoseconds duration);
+	};
+
+	enum class SQLiteThreadingMode
+	{
+		// uses the mode sqlite was compiled or configured with
+		Default,
+		// SQLITE_OPEN_NOMUTEX. no locking inside of the connection
+		MultiThread,
+		// SQLITE_OPEN_FULLMUTEX
+		Serialized
+	};
+
+	enum class SQLiteCacheMode
+	{
+		Default,
+		// SQLITE_OPEN_SHAREDCACHE
+		Shared,
+		// SQLITE_OPEN_PRIVATECACHE
+		Private
+	};
+
+	enum class SQLiteJournalMode
+	{
+		Delete,
+		Truncate,
+		Persist,
+		Memory,
+		Wal,
+		Off
+	};
+
+	// values match the pragma values
+	enum class SQLiteSynchronous
+	{
+		Off = 0,
+		Normal = 1,
+		Full = 2,
+		Extra = 3
+	};
+
+	// values match the pragma values
+	enum class SQLiteTempStore
+	{
+		Default = 0,
+		File = 1,
+		Memory = 2
+	};
+
+	// connection settings applied with pragmas. unset values keep the
+	// sqlite defaults
+	struct SQLiteTuning
+	{
+		std::optional<SQLiteJournalMode> journal_mode;
+		std::optional<SQLiteSynchronous> synchronous;
+		std::optional<SQLiteTempStore> temp_store;
+
+		// bytes. zero disables memory mapped io
+		std::optional<SQLiteInt> mmap_size;
+		// pages if positive, kibibytes if negative
+		std::optional<SQLiteInt> cache_size;
+		// power of two between 512 and 65536. only changes databases
+		// without content or after vacuum and never in wal mode
+		std::optional<int> page_size;
+		// milliseconds. installs SQLiteBusyPolicy::Timeout
+		std::optional<int> busy_timeout;
+
+		// wal with synchronous normal, a large page cache and memory
+		// mapped reads
+		static SQLiteTuning ReadHeavy();
+		// no journal and no syncs. a crash while loading can corrupt
+		// the database
+		static SQLiteTuning BulkLoad();
+		// wal with a sync on every commit
+		static SQLiteTuning Durable();
+
+		// reports invalid values through OnDatabaseCoreFailure
+		bool validate() const;
+	};
+
+	enum class SQLiteBusyStrategy
+	{
+		// SQLITE_BUSY and SQLITE_LOCKED fail right away
+		Fail,
+		// sleeps in growing steps like sqlite3_busy_timeout
+		Timeout,
+		// sleeps exponentially longer with random jitter, so waiting
+		// connections do not retry in lockstep
+		Backoff,
+		// only yields the thread between retries. for short conflicts
+		// between threads of the same process
+		Yield
+	};
+
+	// how a connection waits for locks held by other connections. waits
+	// end after timeout, counted from the first conflict of a statement
+	struct SQLiteBusyPolicy
+	{
+		SQLiteBusyStrategy strategy = SQLiteBusyStrategy::Fail;
+		std::chrono::milliseconds timeout{ 0 };
+
+		// backoff only. the nth retry waits initial_delay * multiplier^n,
+		// at most max_delay, shortened by up to jitter of itself
+		std::chrono::microseconds initial_delay{ 100 };
+		std::chrono::microseconds max_delay{ 50000 };
+		double multiplier = 2.0;
+		double jitter = 0.5;
+
+		static SQLiteBusyPolicy Timeout(std::chrono::milliseconds timeout);
+		static SQLiteBusyPolicy Backoff(std::chrono::milliseconds timeout);
+		static SQLiteBusyPolicy Yield(std::chrono::milliseconds timeout);
+
+		// reports invalid values through OnDatabaseCoreFailure
+		bool validate() const;
+	};
+
+	struct SQLiteBusyStatistics
+	{
+		// lock conflicts that were waited on
+		uint64_t conflicts;
+		uint64_t retries;
+		// conflicts given up on after the timeout
+		uint64_t timeouts;
+		std::chrono::microseconds wait_time;
+	};
+
+	// maps to the flags and vfs of sqlite3_open_v2. the defaults are
+	// equal to sqlite3_open
+	struct SQLiteOpenOptions
+	{
+		bool read_only = false;
+		// ignored for read only connections
+		bool create = true;
+		// interpret filename as uri. "file:data.db?mode=ro"
+		bool uri = false;
+		// in memory database named by filename. can be shared with
+		// SQLiteCacheMode::Shared
+		bool memory = false;
+
+		SQLiteThreadingMode threading = SQLiteThreadingMode::Default;
+		SQLiteCacheMode cache = SQLiteCacheMode::Default;
+
+		// name of a registered vfs. empty uses the default vfs
+		std::string vfs;
+
+		// applied right after the database was opened. a failed tuning
+		// does not fail opening, see SQLiteDatabase::is_tuned
+		std::optional<SQLiteTuning> tuning;
+
+		int get_flags() const;
+	};
+
+	// a connection and its statements must only be used by one thread
+	// at a time. use SQLiteConnectionPool to share a database between
+	// threads
+	enum class SQLiteColumnValidation
+	{
+		None,
+		// column count has to match the row type
+		Count,
+		// declared column types have to fit the row type too. columns
+		// of expressions have no declared type and always fit
+		Types
+	};
+
+	class SQLiteDatabase
+	{
+	public:
+		static constexpr size_t DefaultStatementCacheCapacity = 32;
+
+		SQLiteDatabase(std::string filename,
+			const SQLiteOpenOptions& options = SQLiteOpenOptions{ })
+			:
+			database(NULL),
+			statement_cache(DefaultStatementCacheCapacity)
+		{
+			open(filename, options);
+		}
+
+		~SQLiteDatabase()
+		{
+			// cached statements have to be finalized before close
+			statement_cache.clear();
+
+			// null is a noop
+			sqlite3_close(database);
+		}
+
+		SQLiteDatabase(const SQLiteDatabase&) = delete;
+		SQLiteDatabase& operator=(const SQLiteDatabase&) = delete;
+
+		operator bool()
+		{
+			return database != NULL;
+		}
+
+		std::string last_error_message() const
+		{
+			return sqlite3_errmsg(database);
+		}
+
+		int last_error_code() const
+		{
+			return sqlite3_errcode(database);
+		}
+
+		// rowid of the last successful insert on this connection
+		SQLiteInt last_insert_rowid() const
+		{
+			return sqlite3_last_insert_rowid(database);
+		}
+
+		sqlite3* get_database() const
+		{
+			return database;
+		}
+
+		SQLiteStatementCache& get_statement_cache()
+		{
+			return statement_cache;
+		}
+
+		// profiles statements created after this call. null disables
+		// profiling. the registry has to outlive the statements
+		void set_profiler(SQLiteProfileRegistry* profiler);
+
+		SQLiteProfileRegistry* get_profiler() const
+		{
+			return profiler;
+		}
+
+		// logs statements slower than the threshold of options. replaces
+		// a previous trace log
+		bool enable_trace(const SQLiteTraceOptions& options = { });
+		bool disable_trace();
+
+		// null if tracing is disabled
+		SQLiteTraceLog* get_trace_log() const
+		{
+			return trace_log.get();
+		}
+
+		// checks the columns of statements created after this call
+		// against their row type once per prepared statement
+		void set_column_validation(SQLiteColumnValidation validation);
+
+		SQLiteColumnValidation get_column_validation() const
+		{
+			return column_validation;
+		}
+
+		// applies every set value, even if a previous one failed.
+		// returns false if any value was invalid or not applied
+		bool tune(const SQLiteTuning& tuning);
+
+		// false if the last tuning, including the one of the open
+		// options, failed. the connection stays open with the values
+		// that could be applied
+		bool is_tuned() const
+		{
+			return tuned;
+		}
+
+		// replaces the sqlite busy handler. statements that fail with
+		// SQLITE_BUSY or SQLITE_LOCKED before returning a row are also
+		// reset and retried, as long as no transaction is open
+		bool set_busy_policy(const SQLiteBusyPolicy& policy);
+
+		const SQLiteBusyPolicy& get_busy_policy() const
+		{
+			return busy_policy;
+		}
+
+		// can be read from any thread
+		SQLiteBusyStatistics get_busy_statistics() const;
+		void reset_busy_statistics();
+
+		// waits before retry number attempt of a conflict that started
+		// at since. false if the policy gives up
+		bool wait_busy(int attempt, std::chrono::steady_clock::time_point since);
+
+		// number of open SQLiteSavepoint objects
+		size_t get_savepoint_depth() const
+		{
+			return savepoint_depth;
+		}
+
+		static constexpr size_t DefaultBulkInsertBatchSize = 1000;
+
+		// inserts every row with one prepared statement. outside of a
+		// transaction rows are committed in batches of batch_size. on
+		// failure the current batch is rolled back, while batches
+		// committed before stay committed. inside of a transaction
+		// opened by the caller no additional transactions are used
+		template <typename... Args, typename Range>
+		bool bulk_insert(std::string query, const Range& rows,
+			size_t batch_size = DefaultBulkInsertBatchSize);
+
+	private:
+		friend class SQLiteSavepoint;
+
+		template <typename, typename>
+		friend class SQLiteBasicStatement;
+
+		sqlite3* database;
+		SQLiteStatementCache statement_cache;
+		size_t savepoint_depth = 0;
+
+		SQLiteProfileRegistry* profiler = NULL;
+		std::unique_ptr<SQLiteTraceLog> trace_log;
+
+		SQLiteColumnValidation column_validation = SQLiteColumnValidation::None;
+		bool tuned = true;
+
+		SQLiteBusyPolicy busy_policy;
+		// the conflict of the current step. it is counted once, even if
+		// both the busy handler and the retry of a statement wait on it
+		std::chrono::steady_clock::time_point busy_since;
+		bool busy_counted = false;
+		bool busy_retrying = false;
+		// set if the busy handler gave up on the conflict
+		bool busy_timed_out = false;
+		uint64_t busy_random = 0x9E3779B97F4A7C15;
+
+		std::atomic<uint64_t> busy_conflicts{ 0 };
+		std::atomic<uint64_t> busy_retries{ 0 };
+		std::atomic<uint64_t> busy_timeouts{ 0 };
+		std::atomic<uint64_t> busy_wait_microseconds{ 0 };
+
+		static int BusyHandler(void* data, int attempt);
+		void begin_busy_conflict();
+
+		bool open(const std::string& filename, const SQLiteOpenOptions& options);
+	};
+
+	template <typename T, typename Lazy = void>
+	struct SQLiteStatementColumn
+	{
+	};
+
+	template <typename T, typename Lazy>
+	struct SQLiteStatementColumn<::std::optional<T>, Lazy>
+	{
+		template <typename Tuple, size_t Column = 0>
+		static inline void Extract(Tuple& tuple, sqlite3_stmt* statement)
+		{
+			if (sqlite3_column_type(statement, Column) == SQLITE_NULL)
+			{
+				std::get<Column>(tuple).reset();
+			}
+			else
+			{
+				auto& value = std::get<Column>(tuple);
+
+				// keep an engaged value to reuse its storage
+				if (!value)
+					value.emplace();
+
+				SQLiteStatementColumn<T>::template ExtractAs<Column>(
+					*value, statement);
+			}
+		}
+
+		template <typename Tuple, size_t Column = 0>
+		static inline int Bind(Tuple& tuple, sqlite3_stmt* statement)
+		{
+			return BindAs(std::get<Column>(tuple), Column, statement);
+		}
+
+		static inline int BindAs(const std::optional<T>& value, size_t Column, sqlite3_stmt* statement)
+		{
+			if (value)
+			{
+				return SQLiteStatementColumn<T>::BindAs(*value, Column, statement);
+			}
+			else
+			{
+				return sqlite3_bind_null(statement, Column + 1);
+			}
+		}
+	};
+
+	template <typename Lazy>
+	struct SQLiteStatementColumn<std::nullopt_t, Lazy>
+	{
+		template <typename Tuple, size_t Column = 0>
+		static inline int Bind(Tuple& tuple, sqlite3_stmt* statement)
+		{
+			return BindAs(std::nullopt, Column, statement);
+		}
+
+		static inline int BindAs(std::nullopt_t, size_t Column, sqlite3_stmt* statement)
+		{
+			return sqlite3_bind_null(statement, Column + 1);
+		}
+	};
+
+	template <typename T>
+	struct SQLiteStatementColumn<T, std::enable_if_t<std::is_integral_v<T>>>
+	{
+		template <typename Tuple, size_t Column = 0>
+		static inline void Extract(Tuple& tuple, sqlite3_stmt* statement)
+		{
+			ExtractAs<Column>(std::get<Column>(tuple), statement);
+		}
+
+		template <size_t Column = 0>
+		static inline void ExtractAs(T& value, sqlite3_stmt* statement)
+		{
+			assert(sqlite3_column_type(statement, Column) != SQLITE_NULL);
+			value = (T) sqlite3_column_int64(statement, Column);
+		}
+
+		template <typename Tuple, size_t Column = 0>
+		static inline int Bind(Tuple& tuple, sqlite3_stmt* statement)
+		{
+			return BindAs((SQLiteInt)std::get<Column>(tuple), Column, statement);
+		}
+
+		static inline int BindAs(SQLiteInt value, size_t Column, sqlite3_stmt* statement)
+		{
+			return sqlite3_bind_int64(statement, Column + 1, value);
+		}
+	};
+
+	template <typename T>
+	struct SQLiteStatementColumn<T, std::enable_if_t<std::is_floating_point_v<T>>>
+	{
+		template <typename Tuple, size_t Column = 0>
+		static inline void Extract(Tuple& tuple, sqlite3_stmt* statement)
+		{
+			ExtractAs<Column>(std::get<Column>(tuple), statement);
+		}
+
+		template <size_t Column = 0>
+		static inline void ExtractAs(T& value, sqlite3_stmt* statement)
+		{
+			assert(sqlite3_column_type(statement, Column) != SQLITE_NULL);
+			value = (T) sqlite3_column_double(statement, Column);
+		}
+
+		template <typename Tuple, size_t Column = 0>
+		static inline int Bind(Tuple& tuple, sqlite3_stmt* statement)
+		{
+			return BindAs((SQLiteReal)std::get<Column>(tuple), Column, statement);
+		}
+
+		static inline int BindAs(SQLiteReal value, size_t Column, sqlite3_stmt* statement)
+		{
+			return sqlite3_bind_double(statement, Column + 1, value);
+		}
+	};
+
+	template <typename Lazy>
+	struct SQLiteStatementColumn<SQLiteString, Lazy>
+	{
+		template <typename Tuple, size_t Column = 0>
+		static inline void Extract(Tuple& tuple, sqlite3_stmt* statement)
+		{
+			ExtractAs<Column>(std::get<Column>(tuple), statement);
+		}
+
+		template <size_t Column = 0>
+		static inline void ExtractAs(SQLiteString& value, sqlite3_stmt* statement)
+		{
+			assert(sqlite3_column_type(statement, Column) != SQLITE_NULL);
+			const char* data = (const char*)sqlite3_column_text(statement, Column);
+			value.assign(data, sqlite3_column_bytes(statement, Column));
+		}
+
+		template <typename Tuple, size_t Column = 0>
+		static inline int Bind(Tuple& tuple, sqlite3_stmt* statement)
+		{
+			return BindAs(std::get<Column>(tuple), Column, statement);
+		}
+
+		static inline int BindAs(const SQLiteString& value, size_t Column, sqlite3_stmt* statement,
+			sqlite3_destructor_type destructor = SQLITE_TRANSIENT)
+		{
+			return sqlite3_bind_text(
+				statement, Column + 1, value.c_str(),
+				value.size(),
+				destructor);
+		}
+	};
+
+	template <typename Lazy>
+	struct SQLiteStatementColumn<SQLiteStringView, Lazy>
+	{
+		template <typename Tuple, size_t Column = 0>
+		static inline void Extract(Tuple& tuple, sqlite3_stmt* statement)
+		{
+			ExtractAs<Column>(std::get<Column>(tuple), statement);
+		}
+
+		template <size_t Column = 0>
+		static inline void ExtractAs(SQLiteStringView& value, sqlite3_stmt* statement)
+		{
+			assert(sqlite3_column_type(statement, Column) != SQLITE_NULL);
+			// text has to be converted before bytes are queried
+			const char* data = (const char*)sqlite3_column_text(statement, Column);
+			value = SQLiteStringView(data, sqlite3_column_bytes(statement, Column));
+		}
+
+		template <typename Tuple, size_t Column = 0>
+		static inline int Bind(Tuple& tuple, sqlite3_stmt* statement)
+		{
+			return BindAs(std::get<Column>(tuple), Column, statement);
+		}
+
+		static inline int BindAs(SQLiteStringView value, size_t Column, sqlite3_stmt* statement,
+			sqlite3_destructor_type destructor = SQLITE_TRANSIENT)
+		{
+			// a null pointer would bind null instead of an empty string
+			return sqlite3_bind_text(
+				statement, Column + 1, value.data() ? value.data() : "",
+				value.size(),
+				destructor);
+		}
+	};
+
+	template <typename Lazy>
+	struct SQLiteStatementColumn<const char*, Lazy>
+	{
+		template <typename Tuple, size_t Column = 0>
+		static inline int Bind(Tuple& tuple, sqlite3_stmt* statement)
+		{
+			return BindAs(std::get<Column>(tuple), Column, statement);
+		}
+
+		static inline int BindAs(const char* value, size_t Column, sqlite3_stmt* statement,
+			sqlite3_destructor_type destructor = SQLITE_TRANSIENT)
+		{
+			return sqlite3_bind_text(
+				statement,
+				Column + 1, value,
+				-1,
+				destructor);
+		}
+	};
+
+	template <typename Lazy>
+	struct SQLiteStatementColumn<char*, Lazy>
+		:
+		public SQLiteStatementColumn<const char*>
+	{
+		template <typename Tuple, size_t Column = 0>
+		static inline void Extract(Tuple& tuple, sqlite3_stmt* statement)
+		{
+			ExtractAs<Column>(std::get<Column>(tuple), statement);
+		}
+
+		template <size_t Column = 0>
+		static inline void ExtractAs(char* value, sqlite3_stmt* statement)
+		{
+			assert(sqlite3_column_type(statement, Column) != SQLITE_NULL);
+			memcpy(value,
+				(const void*)sqlite3_column_text(statement, Column),
+				sqlite3_column_bytes(statement, Column));
+		}
+	};
+
+	template <typename Lazy>
+	struct SQLiteStatementColumn<SQLiteBlob, Lazy>
+	{
+		template <typename Tuple, size_t Column = 0>
+		static inline void Extract(Tuple& tuple, sqlite3_stmt* statement)
+		{
+			ExtractAs<Column>(std::get<Column>(tuple), statement);
+		}
+
+		template <size_t Column = 0>
+		static inline void ExtractAs(SQLiteBlob& value, sqlite3_stmt* statement)
+		{
+			assert(sqlite3_column_type(statement, Column) != SQLITE_NULL);
+			const char* data = (const char*)sqlite3_column_blob(statement, Column);
+			value.assign(data, data + sqlite3_column_bytes(statement, Column));
+		}
+
+		template <typename Tuple, size_t Column = 0>
+		static inline int Bind(Tuple& tuple, sqlite3_stmt* statement)
+		{
+			return BindAs(std::get<Column>(tuple), Column, statement);
+		}
+
+		static inline int BindAs(const SQLiteBlob& value, size_t Column, sqlite3_stmt* statement,
+			sqlite3_destructor_type destructor = SQLITE_TRANSIENT)
+		{
+			// a null pointer would bind null instead of an empty blob
+			return sqlite3_bind_blob(
+				statement, Column + 1,
+				value.empty() ? (const void*)"" : (const void*)value.data(),
+				value.size(),
+				destructor);
+		}
+	};
+
+	template <typename Lazy>
+	struct SQLiteStatementColumn<SQLiteBlobView, Lazy>
+	{
+		template <typename Tuple, size_t Column = 0>
+		static inline void Extract(Tuple& tuple, sqlite3_stmt* statement)
+		{
+			ExtractAs<Column>(std::get<Column>(tuple), statement);
+		}
+
+		template <size_t Column = 0>
+		static inline void ExtractAs(SQLiteBlobView& value, sqlite3_stmt* statement)
+		{
+			assert(sqlite3_column_type(statement, Column) != SQLITE_NULL);
+			const unsigned char* data = (const unsigned char*)sqlite3_column_blob(statement, Column);
+			value = SQLiteBlobView(data, sqlite3_column_bytes(statement, Column));
+		}
+
+		template <typename Tuple, size_t Column = 0>
+		static inline int Bind(Tuple& tuple, sqlite3_stmt* statement)
+		{
+			return BindAs(std::get<Column>(tuple), Column, statement);
+		}
+
+		static inline int BindAs(SQLiteBlobView value, size_t Column, sqlite3_stmt* statement,
+			sqlite3_destructor_type destructor = SQLITE_TRANSIENT)
+		{
+			return sqlite3_bind_blob(
+				statement, Column + 1,
+				value.data() ? (const void*)value.data() : (const void*)"",
+				value.size(),
+				destructor);
+		}
+	};
+
+	template <typename Lazy>
+	struct SQLiteStatementColumn<const unsigned char*, Lazy>
+	{
+		template <typename Tuple, size_t Column = 0>
+		static inline int Bind(Tuple& tuple, sqlite3_stmt* statement)
+		{
+			return BindAs(std::get<Column>(tuple), Column, statement);
+		}
+
+		static inline int BindAs(const unsigned char* value, size_t Column, sqlite3_stmt* statement,
+			sqlite3_destructor_type destructor = SQLITE_TRANSIENT)
+		{
+			return sqlite3_bind_blob(
+				statement,
+				Column + 1, (const void*)value,
+				strlen((const char*)value),
+				destructor);
+		}
+	};
+
+	template <typename Lazy>
+	struct SQLiteStatementColumn<unsigned char*, Lazy>
+		:
+		public SQLiteStatementColumn<const unsigned char*>
+	{
+		template <typename Tuple, size_t Column = 0>
+		static inline void Extract(Tuple& tuple, sqlite3_stmt* statement)
+		{
+			ExtractAs<Column>(std::get<Column>(tuple), statement);
+		}
+
+		template <size_t Column = 0>
+		static inline void ExtractAs(unsigned char* value, sqlite3_stmt* statement)
+		{
+			assert(sqlite3_column_type(statement, Column) != SQLITE_NULL);
+			memcpy(value,
+				sqlite3_column_blob(statement, Column),
+				sqlite3_column_bytes(statement, Column));
+		}
+	};
+
+	template <typename Lazy>
+	struct SQLiteStatementColumn<const void*, Lazy>
+	{
+		template <typename Tuple, size_t Column = 0>
+		static inline int Bind(Tuple& tuple, sqlite3_stmt* statement)
+		{
+			return BindAs(std::get<Column>(tuple), Column, statement);
+		}
+
+		static inline int BindAs(const void* value, size_t Column, sqlite3_stmt* statement,
+			sqlite3_destructor_type destructor = SQLITE_TRANSIENT)
+		{
+			return SQLiteStatementColumn<const unsigned char*>::BindAs((const unsigned char*)value, Column, statement, destructor);
+		}
+	};
+
+	template <typename Lazy>
+	struct SQLiteStatementColumn<void*, Lazy>
+		:
+		public SQLiteStatementColumn<const void*>
+	{
+		template <typename Tuple, size_t Column = 0>
+		static inline void Extract(Tuple& tuple, sqlite3_stmt* statement)
+		{
+			ExtractAs<Column>(std::get<Column>(tuple), statement);
+		}
+
+		template <size_t Column = 0>
+		static inline void ExtractAs(void* value, sqlite3_stmt* statement)
+		{
+			SQLiteStatementColumn<unsigned char*>::ExtractAs((unsigned char*)value, statement);
+		}
+	};
 
 	template <typename Character>
 	struct SQLiteStatementColumn<std::basic_string<Character>, std::enable_if_t<!std::is_same_v<Character, char>>>
 	{
-		typedef std::basic_string<Character> String;
+		typedef std::basic_string<Character> String;
+
+		template <typename Tuple, size_t Column = 0>
+		static inline void Extract(Tuple& tuple, sqlite3_stmt* statement)
+		{
+			ExtractAs<Column>(std::get<Column>(tuple), statement);
+		}
+
+		template <size_t Column = 0>
+		static inline void ExtractAs(String& value, sqlite3_stmt* statement)
+		{
+			assert(sqlite3_column_type(statement, Column) != SQLITE_NULL);
+			const typename String::value_type* data =
+				(const typename String::value_type*) sqlite3_column_blob(statement, Column);
+			// blobs are not null terminated
+			value.assign(data, sqlite3_column_bytes(statement, Column) / sizeof(typename String::value_type));
+		}
+
+		template <typename Tuple, size_t Column = 0>
+		static inline int Bind(Tuple& tuple, sqlite3_stmt* statement)
+		{
+			return BindAs(std::get<Column>(tuple), Column, statement);
+		}
+
+		static inline int BindAs(const String& value, size_t Column, sqlite3_stmt* statement,
+			sqlite3_destructor_type destructor = SQLITE_TRANSIENT)
+		{
+			return sqlite3_bind_blob(
+				statement, Column + 1,
+				(const void*)value.c_str(),
+				value.size() * sizeof(typename String::value_type),
+				destructor);
+		}
+	};
+
+	template <typename Lazy>
+	struct SQLiteStatementColumn<const wchar_t*, Lazy>
+	{
+		template <typename Tuple, size_t Column = 0>
+		static inline int Bind(Tuple& tuple, sqlite3_stmt* statement)
+		{
+			return BindAs(std::get<Column>(tuple), Column, statement);
+		}
+
+		static inline int BindAs(const wchar_t* value, size_t Column, sqlite3_stmt* statement,
+			sqlite3_destructor_type destructor = SQLITE_TRANSIENT)
+		{
+			return sqlite3_bind_blob(
+				statement,
+				Column + 1, (const void*)value,
+				wcslen(value) * sizeof(wchar_t),
+				destructor);
+		}
+	};
+
+	template <typename Lazy>
+	struct SQLiteStatementColumn<wchar_t*, Lazy>
+		:
+		public SQLiteStatementColumn<const wchar_t*>
+	{
+		template <typename Tuple, size_t Column = 0>
+		static inline void Extract(Tuple& tuple, sqlite3_stmt* statement)
+		{
+			ExtractAs<Column>(std::get<Column>(tuple), statement);
+		}
+
+		template <size_t Column = 0>
+		static inline void ExtractAs(wchar_t* value, sqlite3_stmt* statement)
+		{
+			assert(sqlite3_column_type(statement, Column) != SQLITE_NULL);
+			memcpy((void*)value,
+				sqlite3_column_blob(statement, Column),
+				sqlite3_column_bytes(statement, Column));
+		}
+	};
+
+	template <typename T, typename Lazy>
+	struct SQLiteStatementColumn<SQLiteStatic<T>, Lazy>
+	{
+		template <typename Tuple, size_t Column = 0>
+		static inline int Bind(Tuple& tuple, sqlite3_stmt* statement)
+		{
+			return BindAs(std::get<Column>(tuple), Column, statement);
+		}
+
+		static inline int BindAs(const SQLiteStatic<T>& value, size_t Column, sqlite3_stmt* statement)
+		{
+			return SQLiteStatementColumn<T>::BindAs(*value.value, Column, statement, SQLITE_STATIC);
+		}
+	};
+
+	// storage class a column type is read from, 0 if it reads any
+	template <typename T, typename Lazy = void>
+	struct SQLiteColumnStorage
+	{
+		static constexpr int Value = 0;
+	};
+
+	template <typename T>
+	struct SQLiteColumnStorage<std::optional<T>>
+		:
+		public SQLiteColumnStorage<T>
+	{
+	};
+
+	template <typename T>
+	struct SQLiteColumnStorage<T, std::enable_if_t<std::is_integral_v<T>>>
+	{
+		static constexpr int Value = SQLITE_INTEGER;
+	};
+
+	template <typename T>
+	struct SQLiteColumnStorage<T, std::enable_if_t<std::is_floating_point_v<T>>>
+	{
+		static constexpr int Value = SQLITE_FLOAT;
+	};
+
+	template <typename T>
+	struct SQLiteColumnStorage<T, std::enable_if_t<
+		std::is_same_v<T, SQLiteString>
+		|| std::is_same_v<T, SQLiteStringView>
+		|| std::is_same_v<T, char*>>>
+	{
+		static constexpr int Value = SQLITE_TEXT;
+	};
+
+	template <typename T>
+	struct SQLiteColumnStorage<T, std::enable_if_t<
+		std::is_same_v<T, SQLiteBlob>
+		|| std::is_same_v<T, SQLiteBlobView>
+		|| std::is_same_v<T, std::wstring>
+		|| std::is_same_v<T, unsigned char*>
+		|| std::is_same_v<T, wchar_t*>>>
+	{
+		static constexpr int Value = SQLITE_BLOB;
+	};
+
+	// views point into the column buffers of sqlite, which are only
+	// valid until the statement steps or resets again
+	template <typename T>
+	struct SQLiteIsColumnView
+		:
+		public std::bool_constant<
+			std::is_same_v<T, SQLiteStringView>
+			|| std::is_same_v<T, SQLiteBlobView>>
+	{
+	};
+
+	template <typename T>
+	struct SQLiteIsColumnView<std::optional<T>>
+		:
+		public SQLiteIsColumnView<T>
+	{
+	};
+
+	template <typename Columns>
+	struct SQLiteHasColumnView
+	{
+	};
+
+	template <typename... Args>
+	struct SQLiteHasColumnView<std::tuple<Args...>>
+		:
+		public std::bool_constant<(SQLiteIsColumnView<Args>::value || ...)>
+	{
+	};
+
+	// false if a column declared as declared_type can not hold values of
+	// storage. null declared_type always fits
+	bool SQLiteDeclaredTypeFits(int storage, const char* declared_type);
+
+	template <typename Lazy>
+	struct SQLiteStatementColumn<SQLiteZeroBlob, Lazy>
+	{
+		template <typename Tuple, size_t Column = 0>
+		static inline int Bind(Tuple& tuple, sqlite3_stmt* statement)
+		{
+			return BindAs(std::get<Column>(tuple), Column, statement);
+		}
+
+		static inline int BindAs(const SQLiteZeroBlob& value, size_t Column, sqlite3_stmt* statement)
+		{
+			return sqlite3_bind_zeroblob64(statement, Column + 1, value.size);
+		}
+	};
+
+	template <typename T, typename... Args>
+	struct SQLiteStatementColumnUnpacker
+	{
+		template <typename Tuple, size_t Column = 0>
+		static inline void Extract(Tuple& tuple, sqlite3_stmt* statement)
+		{
+			SQLiteStatementColumnUnpacker<T>::template Extract<Tuple, Column>(tuple, statement);
+			SQLiteStatementColumnUnpacker<Args...>::template Extract<Tuple, Column + 1>(tuple, statement);
+		}
+
+		template <typename Tuple, size_t Column = 0>
+		static inline int Bind(Tuple& tuple, sqlite3_stmt* statement)
+		{
+			int result = SQLiteStatementColumnUnpacker<T>::template Bind<Tuple, Column>(tuple, statement);
+			if (result != SQLITE_OK)
+			{
+				return result;
+			}
+
+			return SQLiteStatementColumnUnpacker<Args...>::template Bind<Tuple, Column + 1>(tuple, statement);
+		}
+	};
+
+	template <typename T>
+	struct SQLiteStatementColumnUnpacker<T>
+	{
+		template <typename Tuple, size_t Column = 0>
+		static inline void Extract(Tuple& tuple, sqlite3_stmt* statement)
+		{
+			SQLiteStatementColumn<T>::template Extract<Tuple, Column>(tuple, statement);
+		}
+
+		template <typename Tuple, size_t Column = 0>
+		static inline int Bind(Tuple& tuple, sqlite3_stmt* statement)
+		{
+			return SQLiteStatementColumn<T>::template Bind<Tuple, Column>(tuple, statement);
+		}
+	};
+
+	template <typename Tuple>
+	struct SQLiteStatementColumnTuple
+	{
+	};
+
+	template <typename... Args>
+	struct SQLiteStatementColumnTuple<std::tuple<Args...>>
+		:
+		public SQLiteStatementColumnUnpacker<Args...>
+	{
+	};
+
+	// maps the members of a struct to columns in their order, so the
+	// struct can be used as row type of a statement. specialized by
+	// DATABASECORE_MAP
+	template <typename Row>
+	struct SQLiteRowMapping
+	{
+		static constexpr bool Mapped = false;
+	};
+
+	template <typename... Rows>
+	struct SQLiteIsMappedRow
+		:
+		public std::false_type
+	{
+	};
+
+	template <typename Row>
+	struct SQLiteIsMappedRow<Row>
+		:
+		public std::bool_constant<SQLiteRowMapping<Row>::Mapped>
+	{
+	};
+
+	// column values of a row type. Tie gives a tuple referencing the
+	// columns of a row, which is the row itself for tuples
+	template <typename Row, typename Lazy = void>
+	struct SQLiteRowTraits
+	{
+	};
+
+	template <typename... Args>
+	struct SQLiteRowTraits<std::tuple<Args...>>
+	{
+		typedef std::tuple<Args...> Columns;
+
+		static Columns& Tie(Columns& row)
+		{
+			return row;
+		}
+
+		static const Columns& Tie(const Columns& row)
+		{
+			return row;
+		}
+	};
+
+	template <typename Row>
+	struct SQLiteRowTraits<Row, std::enable_if_t<SQLiteRowMapping<Row>::Mapped>>
+	{
+		template <typename Tied>
+		struct Decay
+		{
+		};
+
+		template <typename... Members>
+		struct Decay<std::tuple<Members...>>
+		{
+			typedef std::tuple<std::decay_t<Members>...> Type;
+		};
+
+		typedef typename Decay<decltype(SQLiteRowMapping<Row>::Tie(std::declval<Row&>()))>::Type Columns;
+
+		static auto Tie(Row& row)
+		{
+			return SQLiteRowMapping<Row>::Tie(row);
+		}
+
+		static auto Tie(const Row& row)
+		{
+			return SQLiteRowMapping<Row>::Tie(row);
+		}
+	};
+
+	// row type of a statement with column types Args. a single mapped
+	// struct is its own row
+	template <typename... Args>
+	using SQLiteRowOf = std::conditional_t<SQLiteIsMappedRow<Args...>::value,
+		std::tuple_element_t<0, std::tuple<Args..., void>>,
+		std::tuple<Args...>>;
+
+	// applies f to every argument, up to 32 of them. the expansions
+	// are needed for the msvc preprocessor to split __VA_ARGS__
+#define DATABASECORE_EXPAND(x) x
+#define DATABASECORE_FOR_EACH_1(f, x) f(x)
+#define DATABASECORE_FOR_EACH_2(f, x, ...) f(x), DATABASECORE_EXPAND(DATABASECORE_FOR_EACH_1(f, __VA_ARGS__))
+#define DATABASECORE_FOR_EACH_3(f, x, ...) f(x), DATABASECORE_EXPAND(DATABASECORE_FOR_EACH_2(f, __VA_ARGS__))
+#define DATABASECORE_FOR_EACH_4(f, x, ...) f(x), DATABASECORE_EXPAND(DATABASECORE_FOR_EACH_3(f, __VA_ARGS__))
+#define DATABASECORE_FOR_EACH_5(f, x, ...) f(x), DATABASECORE_EXPAND(DATABASECORE_FOR_EACH_4(f, __VA_ARGS__))
+#define DATABASECORE_FOR_EACH_6(f, x, ...) f(x), DATABASECORE_EXPAND(DATABASECORE_FOR_EACH_5(f, __VA_ARGS__))
+#define DATABASECORE_FOR_EACH_7(f, x, ...) f(x), DATABASECORE_EXPAND(DATABASECORE_FOR_EACH_6(f, __VA_ARGS__))
+#define DATABASECORE_FOR_EACH_8(f, x, ...) f(x), DATABASECORE_EXPAND(DATABASECORE_FOR_EACH_7(f, __VA_ARGS__))
+#define DATABASECORE_FOR_EACH_9(f, x, ...) f(x), DATABASECORE_EXPAND(DATABASECORE_FOR_EACH_8(f, __VA_ARGS__))
+#define DATABASECORE_FOR_EACH_10(f, x, ...) f(x), DATABASECORE_EXPAND(DATABASECORE_FOR_EACH_9(f, __VA_ARGS__))
+#define DATABASECORE_FOR_EACH_11(f, x, ...) f(x), DATABASECORE_EXPAND(DATABASECORE_FOR_EACH_10(f, __VA_ARGS__))
+#define DATABASECORE_FOR_EACH_12(f, x, ...) f(x), DATABASECORE_EXPAND(DATABASECORE_FOR_EACH_11(f, __VA_ARGS__))
+#define DATABASECORE_FOR_EACH_13(f, x, ...) f(x), DATABASECORE_EXPAND(DATABASECORE_FOR_EACH_12(f, __VA_ARGS__))
+#define DATABASECORE_FOR_EACH_14(f, x, ...) f(x), DATABASECORE_EXPAND(DATABASECORE_FOR_EACH_13(f, __VA_ARGS__))
+#define DATABASECORE_FOR_EACH_15(f, x, ...) f(x), DATABASECORE_EXPAND(DATABASECORE_FOR_EACH_14(f, __VA_ARGS__))
+#define DATABASECORE_FOR_EACH_16(f, x, ...) f(x), DATABASECORE_EXPAND(DATABASECORE_FOR_EACH_15(f, __VA_ARGS__))
+#define DATABASECORE_FOR_EACH_17(f, x, ...) f(x), DATABASECORE_EXPAND(DATABASECORE_FOR_EACH_16(f, __VA_ARGS__))
+#define DATABASECORE_FOR_EACH_18(f, x, ...) f(x), DATABASECORE_EXPAND(DATABASECORE_FOR_EACH_17(f, __VA_ARGS__))
+#define DATABASECORE_FOR_EACH_19(f, x, ...) f(x), DATABASECORE_EXPAND(DATABASECORE_FOR_EACH_18(f, __VA_ARGS__))
+#define DATABASECORE_FOR_EACH_20(f, x, ...) f(x), DATABASECORE_EXPAND(DATABASECORE_FOR_EACH_19(f, __VA_ARGS__))
+#define DATABASECORE_FOR_EACH_21(f, x, ...) f(x), DATABASECORE_EXPAND(DATABASECORE_FOR_EACH_20(f, __VA_ARGS__))
+#define DATABASECORE_FOR_EACH_22(f, x, ...) f(x), DATABASECORE_EXPAND(DATABASECORE_FOR_EACH_21(f, __VA_ARGS__))
+#define DATABASECORE_FOR_EACH_23(f, x, ...) f(x), DATABASECORE_EXPAND(DATABASECORE_FOR_EACH_22(f, __VA_ARGS__))
+#define DATABASECORE_FOR_EACH_24(f, x, ...) f(x), DATABASECORE_EXPAND(DATABASECORE_FOR_EACH_23(f, __VA_ARGS__))
+#define DATABASECORE_FOR_EACH_25(f, x, ...) f(x), DATABASECORE_EXPAND(DATABASECORE_FOR_EACH_24(f, __VA_ARGS__))
+#define DATABASECORE_FOR_EACH_26(f, x, ...) f(x), DATABASECORE_EXPAND(DATABASECORE_FOR_EACH_25(f, __VA_ARGS__))
+#define DATABASECORE_FOR_EACH_27(f, x, ...) f(x), DATABASECORE_EXPAND(DATABASECORE_FOR_EACH_26(f, __VA_ARGS__))
+#define DATABASECORE_FOR_EACH_28(f, x, ...) f(x), DATABASECORE_EXPAND(DATABASECORE_FOR_EACH_27(f, __VA_ARGS__))
+#define DATABASECORE_FOR_EACH_29(f, x, ...) f(x), DATABASECORE_EXPAND(DATABASECORE_FOR_EACH_28(f, __VA_ARGS__))
+#define DATABASECORE_FOR_EACH_30(f, x, ...) f(x), DATABASECORE_EXPAND(DATABASECORE_FOR_EACH_29(f, __VA_ARGS__))
+#define DATABASECORE_FOR_EACH_31(f, x, ...) f(x), DATABASECORE_EXPAND(DATABASECORE_FOR_EACH_30(f, __VA_ARGS__))
+#define DATABASECORE_FOR_EACH_32(f, x, ...) f(x), DATABASECORE_EXPAND(DATABASECORE_FOR_EACH_31(f, __VA_ARGS__))
+#define DATABASECORE_FOR_EACH_SELECT(_1, _2, _3, _4, _5, _6, _7, _8, _9, _10, _11, _12, _13, _14, _15, _16, _17, _18, _19, _20, _21, _22, _23, _24, _25, _26, _27, _28, _29, _30, _31, _32, name, ...) name
+#define DATABASECORE_FOR_EACH(f, ...) \
+	DATABASECORE_EXPAND(DATABASECORE_FOR_EACH_SELECT(__VA_ARGS__, \
+		DATABASECORE_FOR_EACH_32, DATABASECORE_FOR_EACH_31, DATABASECORE_FOR_EACH_30, DATABASECORE_FOR_EACH_29, DATABASECORE_FOR_EACH_28, DATABASECORE_FOR_EACH_27, DATABASECORE_FOR_EACH_26, DATABASECORE_FOR_EACH_25, DATABASECORE_FOR_EACH_24, \
+		DATABASECORE_FOR_EACH_23, DATABASECORE_FOR_EACH_22, DATABASECORE_FOR_EACH_21, DATABASECORE_FOR_EACH_20, DATABASECORE_FOR_EACH_19, DATABASECORE_FOR_EACH_18, DATABASECORE_FOR_EACH_17, DATABASECORE_FOR_EACH_16, \
+		DATABASECORE_FOR_EACH_15, DATABASECORE_FOR_EACH_14, DATABASECORE_FOR_EACH_13, DATABASECORE_FOR_EACH_12, DATABASECORE_FOR_EACH_11, DATABASECORE_FOR_EACH_10, DATABASECORE_FOR_EACH_9, DATABASECORE_FOR_EACH_8, \
+		DATABASECORE_FOR_EACH_7, DATABASECORE_FOR_EACH_6, DATABASECORE_FOR_EACH_5, DATABASECORE_FOR_EACH_4, DATABASECORE_FOR_EACH_3, DATABASECORE_FOR_EACH_2, DATABASECORE_FOR_EACH_1)(f, __VA_ARGS__))
+
+#define DATABASECORE_MAP_MEMBER(member) row.member
+
+	// DATABASECORE_MAP(Struct, member, ...) at global scope lets
+	// Statement<Struct> extract into and bind from the listed members
+	// directly. every member needs an SQLiteStatementColumn
+#define DATABASECORE_MAP(Type, ...) \
+	template <> \
+	struct Database::SQLiteRowMapping<Type> \
+	{ \
+		static constexpr bool Mapped = true; \
+		\
+		static auto Tie(Type& row) \
+		{ \
+			return std::tie(DATABASECORE_FOR_EACH(DATABASECORE_MAP_MEMBER, __VA_ARGS__)); \
+		} \
+		\
+		static auto Tie(const Type& row) \
+		{ \
+			return std::tie(DATABASECORE_FOR_EACH(DATABASECORE_MAP_MEMBER, __VA_ARGS__)); \
+		} \
+	};
+
+	// struct of arrays batch of rows. every column is stored in its own
+	// contiguous vector, ready for vectorized processing
+	template <typename Tuple>
+	class SQLiteColumnBatch
+	{
+	};
+
+	template <typename... Args>
+	class SQLiteColumnBatch<std::tuple<Args...>>
+	{
+	public:
+		typedef std::tuple<std::vector<Args>...> Columns;
+
+		size_t size() const
+		{
+			return std::get<0>(columns).size();
+		}
+
+		bool empty() const
+		{
+			return size() == 0;
+		}
+
+		template <size_t Column>
+		std::vector<std::tuple_element_t<Column, std::tuple<Args...>>>& get_column()
+		{
+			return std::get<Column>(columns);
+		}
+
+		template <size_t Column>
+		const std::vector<std::tuple_element_t<Column, std::tuple<Args...>>>& get_column() const
+		{
+			return std::get<Column>(columns);
+		}
+
+		Columns& get_columns()
+		{
+			return columns;
+		}
+
+		void reserve(size_t size)
+		{
+			std::apply([size](auto&... column) { (column.reserve(size), ...); }, columns);
+		}
+
+		void clear()
+		{
+			std::apply([](auto&... column) { (column.clear(), ...); }, columns);
+		}
+
+		// extracts the current row of statement directly into the columns
+		void append(sqlite3_stmt* statement)
+		{
+			append(statement, std::index_sequence_for<Args...>{ });
+		}
+
+	private:
+		Columns columns;
+
+		template <size_t... Index>
+		void append(sqlite3_stmt* statement, std::index_sequence<Index...>)
+		{
+			std::tuple<Args&...> row{ std::get<Index>(columns).emplace_back()... };
+			SQLiteStatementColumnUnpacker<Args...>::Extract(row, statement);
+		}
+	};
+
+	// location of a text or blob column inside of an SQLiteArena
+	struct SQLiteArenaText
+	{
+		size_t offset;
+		size_t size;
+	};
 
-		template <typename Tuple, size_t Column = 0>
-		static inline void Extract(Tuple& tuple, sqlite3_stmt* statement)
+	struct SQLiteArenaBlob
+	{
+		size_t offset;
+		size_t size;
+	};
+
+	// one contiguous slab for the text and blob columns of collected
+	// rows, which only hold offsets into it. everything is released
+	// together by clear, which keeps the capacity. an arena reused for
+	// every request stops allocating once it fits the largest result
+	class SQLiteArena
+	{
+	public:
+		SQLiteArena(size_t capacity = 0)
 		{
-			ExtractAs<Column>(std::get<Column>(tuple), statement);
+			slab.reserve(capacity);
 		}
 
-		template <size_t Column = 0>
-		static inline void ExtractAs(String& value, sqlite3_stmt* statement)
+		size_t store(const void* data, size_t size)
 		{
-			assert(sqlite3_column_type(statement, Column) != SQLITE_NULL);
-			value.assign((const typename String::value_type*) sqlite3_column_blob(statement, Column));
+			const size_t offset = slab.size();
+			const char* const begin = (const char*) data;
+
+			// sqlite returns null for empty values
+			if (size > 0)
+				slab.insert(slab.end(), begin, begin + size);
+
+			return offset;
 		}
 
-		template <typename Tuple, size_t Column = 0>
-		static inline int Bind(Tuple& tuple, sqlite3_stmt* statement)
+		// views are valid until the arena grows or is cleared
+		SQLiteStringView get(const SQLiteArenaText& text) const
 		{
-			return BindAs(std::get<Column>(tuple), Column, statement);
+			assert(text.offset + text.size <= slab.size());
+			return SQLiteStringView(slab.data() + text.offset, text.size);
 		}
 
-		static inline int BindAs(String& value, size_t Column, sqlite3_stmt* statement)
+		SQLiteBlobView get(const SQLiteArenaBlob& blob) const
 		{
-			return sqlite3_bind_blob(
-				statement, Column + 1,
-				(const void*)value.c_str(),
-				value.size() * sizeof(typename String::value_type),
-				SQLITE_TRANSIENT);
+			assert(blob.offset + blob.size <= slab.size());
+			return SQLiteBlobView((const unsigned char*) slab.data() + blob.offset, blob.size);
 		}
-	};
 
-	template <typename Lazy>
-	struct SQLiteStatementColumn<const wchar_t*, Lazy>
-	{
-		template <typename Tuple, size_t Column = 0>
-		static inline int Bind(Tuple& tuple, sqlite3_stmt* statement)
+		size_t size() const
 		{
-			return BindAs(std::get<Column>(tuple), Column, statement);
+			return slab.size();
 		}
 
-		static inline int BindAs(const wchar_t* value, size_t Column, sqlite3_stmt* statement)
+		size_t capacity() const
 		{
-			return sqlite3_bind_blob(
-				statement,
-				Column + 1, (const void*)value,
-				wcslen(value) * sizeof(wchar_t),
-				SQLITE_TRANSIENT);
+			return slab.capacity();
 		}
-	};
 
-	template <typename Lazy>
-	struct SQLiteStatementColumn<wchar_t*, Lazy>
-		:
-		public SQLiteStatementColumn<const wchar_t*>
-	{
-		template <typename Tuple, size_t Column = 0>
-		static inline void Extract(Tuple& tuple, sqlite3_stmt* statement)
+		void reserve(size_t capacity)
 		{
-			ExtractAs<Column>(std::get<Column>(tuple), statement);
+			slab.reserve(capacity);
 		}
 
-		template <size_t Column = 0>
-		static inline void ExtractAs(wchar_t* value, sqlite3_stmt* statement)
+		void clear()
 		{
-			assert(sqlite3_column_type(statement, Column) != SQLITE_NULL);
-			memcpy((void*)value,
-				sqlite3_column_blob(statement, Column),
-				sqlite3_column_bytes(statement, Column));
+			slab.clear();
 		}
+
+	private:
+		std::vector<char> slab;
 	};
 
-	template <typename T, typename... Args>
-	struct SQLiteStatementColumnUnpacker
+	// type a column of type T is collected as. text and blobs are
+	// moved into the arena, every other type is extracted as usual
+	template <typename T, typename Lazy = void>
+	struct SQLiteArenaColumn
 	{
-		template <typename Tuple, size_t Column = 0>
-		static inline void Extract(Tuple& tuple, sqlite3_stmt* statement)
+		typedef T Type;
+
+		template <size_t Column>
+		static inline void Extract(Type& value, sqlite3_stmt* statement, SQLiteArena&)
 		{
-			SQLiteStatementColumnUnpacker<T>::template Extract<Tuple, Column>(tuple, statement);
-			SQLiteStatementColumnUnpacker<Args...>::template Extract<Tuple, Column + 1>(tuple, statement);
+			SQLiteStatementColumn<T>::template ExtractAs<Column>(value, statement);
 		}
+	};
 
-		template <typename Tuple, size_t Column = 0>
-		static inline int Bind(Tuple& tuple, sqlite3_stmt* statement)
+	template <typename T>
+	struct SQLiteArenaColumn<std::optional<T>>
+	{
+		typedef std::optional<typename SQLiteArenaColumn<T>::Type> Type;
+
+		template <size_t Column>
+		static inline void Extract(Type& value, sqlite3_stmt* statement, SQLiteArena& arena)
 		{
-			int result = SQLiteStatementColumnUnpacker<T>::template Bind<Tuple, Column>(tuple, statement);
-			if (result != SQLITE_OK)
+			if (sqlite3_column_type(statement, Column) == SQLITE_NULL)
 			{
-				return result;
+				value.reset();
+			}
+			else
+			{
+				SQLiteArenaColumn<T>::template Extract<Column>(value.emplace(), statement, arena);
 			}
-
-			return SQLiteStatementColumnUnpacker<Args...>::template Bind<Tuple, Column + 1>(tuple, statement);
 		}
 	};
 
 	template <typename T>
-	struct SQLiteStatementColumnUnpacker<T>
+	struct SQLiteArenaColumn<T, std::enable_if_t<
+		std::is_same_v<T, SQLiteString>
+		|| std::is_same_v<T, SQLiteStringView>>>
 	{
-		template <typename Tuple, size_t Column = 0>
-		static inline void Extract(Tuple& tuple, sqlite3_stmt* statement)
+		typedef SQLiteArenaText Type;
+
+		template <size_t Column>
+		static inline void Extract(Type& value, sqlite3_stmt* statement, SQLiteArena& arena)
 		{
-			SQLiteStatementColumn<T>::template Extract<Tuple, Column>(tuple, statement);
+			assert(sqlite3_column_type(statement, Column) != SQLITE_NULL);
+			// text has to be converted before bytes are queried
+			const unsigned char* data = sqlite3_column_text(statement, Column);
+			value.size = sqlite3_column_bytes(statement, Column);
+			value.offset = arena.store(data, value.size);
 		}
+	};
 
-		template <typename Tuple, size_t Column = 0>
-		static inline int Bind(Tuple& tuple, sqlite3_stmt* statement)
+	template <typename T>
+	struct SQLiteArenaColumn<T, std::enable_if_t<
+		std::is_same_v<T, SQLiteBlob>
+		|| std::is_same_v<T, SQLiteBlobView>>>
+	{
+		typedef SQLiteArenaBlob Type;
+
+		template <size_t Column>
+		static inline void Extract(Type& value, sqlite3_stmt* statement, SQLiteArena& arena)
 		{
-			return SQLiteStatementColumn<T>::template Bind<Tuple, Column>(tuple, statement);
+			assert(sqlite3_column_type(statement, Column) != SQLITE_NULL);
+			const void* data = sqlite3_column_blob(statement, Column);
+			value.size = sqlite3_column_bytes(statement, Column);
+			value.offset = arena.store(data, value.size);
 		}
 	};
 
-	template <typename Tuple>
-	struct SQLiteStatementColumnTuple
+	template <typename Columns>
+	struct SQLiteArenaRow
 	{
 	};
 
 	template <typename... Args>
-	struct SQLiteStatementColumnTuple<std::tuple<Args...>>
-		:
-		public SQLiteStatementColumnUnpacker<Args...>
+	struct SQLiteArenaRow<std::tuple<Args...>>
 	{
+		typedef std::tuple<typename SQLiteArenaColumn<Args>::Type...> Type;
+
+		static inline void Extract(Type& row, sqlite3_stmt* statement, SQLiteArena& arena)
+		{
+			Extract(row, statement, arena, std::index_sequence_for<Args...>{ });
+		}
+
+	private:
+		template <size_t... Index>
+		static inline void Extract(Type& row, sqlite3_stmt* statement, SQLiteArena& arena,
+			std::index_sequence<Index...>)
+		{
+			(SQLiteArenaColumn<Args>::template Extract<Index>(std::get<Index>(row), statement, arena), ...);
+		}
 	};
 
 	enum class SQLiteStatementStatus
@@ -483,11 +1938,18 @@ namespace Database
 		Failed
 	};
 
-	template <typename T>
+	// rows are extracted into the tuple owned by the statement, which
+	// reuses its storage. use "for (const auto& row : statement)" or
+	// structured bindings to avoid a copy per row. a move iterator moves
+	// every row out of the statement for consumers that keep the rows
+	template <typename T, bool Move = false>
 	class SQLiteStatementIterator
 	{
-		template <typename...>
-		friend class SQLiteStatement;
+		template <typename, typename>
+		friend class SQLiteBasicStatement;
+
+		template <typename>
+		friend class SQLiteStatementMoveRange;
 
 		enum class Type
 		{
@@ -507,13 +1969,26 @@ namespace Database
 
 		typedef Tuple value_type;
 		typedef std::ptrdiff_t difference_type;
-		typedef Tuple* pointer;
-		typedef Tuple& reference;
+		typedef const Tuple* pointer;
+		typedef std::conditional_t<Move, Tuple&&, const Tuple&> reference;
 		typedef std::input_iterator_tag iterator_category;
 
-		const Tuple& operator*() const
+		reference operator*() const
+		{
+			if constexpr (Move)
+			{
+				return statement->take_tuple();
+			}
+			else
+			{
+				return statement->get_tuple();
+			}
+		}
+
+		pointer operator->() const
 		{
-			return statement->get_tuple();
+			static_assert(!Move, "move iterator does not support operator->");
+			return &statement->get_tuple();
 		}
 
 		bool operator==(const SQLiteStatementIterator& other) const
@@ -543,137 +2018,366 @@ namespace Database
 		Type type;
 	};
 
-	template <typename... Args>
-	class SQLiteStatement
-		:
-		public SQLiteStatement<std::tuple<Args...>>
+	template <typename T>
+	class SQLiteStatementMoveRange
 	{
-		typedef SQLiteStatement<std::tuple<Args...>> Parent;
-
 	public:
-		using Parent::Parent;
+		typedef SQLiteStatementIterator<T, true> Iterator;
+
+		SQLiteStatementMoveRange(T* statement)
+			:
+			statement(statement)
+		{
+		}
+
+		Iterator begin()
+		{
+			return Iterator{ statement,
+				statement->begin() != statement->end()
+				? Iterator::Type::Begin
+				: Iterator::Type::End };
+		}
+
+		Iterator end()
+		{
+			return Iterator{ statement, Iterator::Type::End };
+		}
+
+	private:
+		T* statement;
 	};
 
-	template <typename... Args>
-	class SQLiteStatement<std::tuple<Args...>>
+	// statement with rows of type Row, a tuple or a struct mapped with
+	// DATABASECORE_MAP. ErrorPolicy is one of SQLiteErrorPolicy and
+	// decides how failures are reported
+	template <typename Row, typename ErrorPolicy = SQLiteErrorPolicy::Callback>
+	class SQLiteBasicStatement
 	{
+		typedef SQLiteRowTraits<Row> Traits;
+
 	public:
-		typedef std::tuple<Args...> Tuple;
-		typedef SQLiteStatementIterator<SQLiteStatement<Tuple>> Iterator;
+		typedef Row Tuple;
+		typedef typename Traits::Columns Columns;
+		typedef SQLiteStatementIterator<SQLiteBasicStatement> Iterator;
+
+		// checks the number of bind arguments against the placeholders
+		// of query at compile time
+		template <size_t Placeholders, typename... BindArgs>
+		SQLiteBasicStatement(SQLiteDatabase* database, SQLiteQuery<Placeholders> query, BindArgs... bind_args)
+			:
+			SQLiteBasicStatement(database, query, std::make_tuple(bind_args...))
+		{
+		}
 
-		template <typename... Args>
-		SQLiteStatement(SQLiteDatabase* database, std::string query, Args... bind_args)
+		template <size_t Placeholders, typename... BindArgs>
+		SQLiteBasicStatement(SQLiteDatabase* database, SQLiteQuery<Placeholders> query, std::tuple<BindArgs...> bind_tuple)
 			:
-			SQLiteStatement(database, query, std::make_tuple(bind_args...))
+			SQLiteBasicStatement(database, std::string(query.text), std::move(bind_tuple))
 		{
+			static_assert(Placeholders == SQLiteUncountedPlaceholders || Placeholders == sizeof...(BindArgs),
+				"got wrong number of bind arguments for query in databasecore statement");
 		}
 
-		template <typename... Args>
-		SQLiteStatement(SQLiteDatabase* database, std::string query, std::tuple<Args...> bind_tuple)
+		template <size_t Placeholders>
+		SQLiteBasicStatement(SQLiteDatabase* database, SQLiteQuery<Placeholders> query)
 			:
-			SQLiteStatement(database, query)
+			SQLiteBasicStatement(database, std::string(query.text))
+		{
+		}
+
+		template <typename... BindArgs>
+		SQLiteBasicStatement(SQLiteDatabase* database, std::string query, BindArgs... bind_args)
+			:
+			SQLiteBasicStatement(database, query, std::make_tuple(bind_args...))
+		{
+		}
+
+		template <typename... BindArgs>
+		SQLiteBasicStatement(SQLiteDatabase* database, std::string query, std::tuple<BindArgs...> bind_tuple)
+			:
+			SQLiteBasicStatement(database, query)
 		{
 			bind(bind_tuple);
 		}
 
-		template <typename... Args>
-		SQLiteStatement(SQLiteDatabase* database, std::string query)
+		SQLiteBasicStatement(SQLiteDatabase* database, std::string query)
 			:
 			database(database),
+			profiler(database->get_profiler()),
+			query(std::move(query)),
 			status(SQLiteStatementStatus::Ready)
 		{
-			ensureStatusCode(
-				sqlite3_prepare_v2(
-					database->get_database(),
-					query.c_str(),
-					-1, &statement, NULL),
-				"failed to prepare statement");
+			statement = database->get_statement_cache().checkout(this->query, &validated);
+
+			if (statement == NULL)
+			{
+				const auto begin = profiler
+					? std::chrono::steady_clock::now()
+					: std::chrono::steady_clock::time_point{ };
+
+				if (ensureStatusCode(
+						sqlite3_prepare_v2(
+							database->get_database(),
+							this->query.c_str(),
+							-1, &statement, NULL),
+						"failed to prepare statement")
+					&& profiler)
+				{
+					profiler->record_prepare(this->query, std::chrono::steady_clock::now() - begin);
+				}
+			}
+
+			if (statement
+				&& validated != GetValidationTag()
+				&& database->column_validation != SQLiteColumnValidation::None)
+			{
+				validate(database->column_validation);
+			}
 		}
 
-		virtual ~SQLiteStatement()
+		virtual ~SQLiteBasicStatement()
 		{
-			// finalize only fails if previous functions failed and
-			// does not give meaningfull information
-			// null check not needed. with null is a noop
-			sqlite3_finalize(statement);
+			// failed statements are already finalized
+			if (statement)
+			{
+				record_profile();
+
+				// reset and clear_bindings only fail if previous functions
+				// failed and do not give meaningfull information
+				sqlite3_reset(statement);
+				sqlite3_clear_bindings(statement);
+
+				database->get_statement_cache().checkin(query, statement, validated);
+			}
 		}
 
+		SQLiteBasicStatement(const SQLiteBasicStatement&) = delete;
+		SQLiteBasicStatement& operator=(const SQLiteBasicStatement&) = delete;
+
 		operator bool()
 		{
 			return status != SQLiteStatementStatus::Failed;
 		}
 
-		Iterator begin()
+		Iterator begin()
+		{
+			if (status == SQLiteStatementStatus::Ready)
+			{
+				step();
+			}
+
+			return Iterator{ this,
+				status == SQLiteStatementStatus::Running
+				? Iterator::Type::Begin
+				: Iterator::Type::End };
+		}
+
+		Iterator end()
+		{
+			return Iterator{ this, Iterator::Type::End };
+		}
+
+		// "for (Tuple row : statement.consume())" moves every row out
+		// of the statement instead of copying it
+		SQLiteStatementMoveRange<SQLiteBasicStatement> consume()
+		{
+			static_assert(!SQLiteHasColumnView<Columns>::value,
+				"got view column in databasecore statement consume, views do not outlive the row");
+
+			return { this };
+		}
+
+		template <typename T>
+		bool execute(T& value)
+		{
+			static_assert(std::is_same_v<std::tuple<T>, Tuple>,
+				"got invalid type in databasecore statement execute<T>");
+
+			Tuple tuple;
+			if (!execute(tuple))
+			{
+				return false;
+			}
+
+			value = std::move(std::get<0>(tuple));
+			return true;
+		}
+
+		bool execute(Tuple& tuple)
+		{
+			static_assert(!SQLiteHasColumnView<Columns>::value,
+				"got view column in databasecore statement execute, views do not outlive the row");
+
+			return step(tuple) && execute();
+		}
+
+		bool execute()
+		{
+			switch (status)
+			{
+			case SQLiteStatementStatus::Failed:
+				ErrorPolicy::Report("tried to execute statement after failure");
+
+				return false;
+			case SQLiteStatementStatus::Finished:
+				ErrorPolicy::Report("tried to execute statement after finish");
+
+				return false;
+			}
+
+			const int result = execute_statement();
+
+			if (result != SQLITE_DONE)
+			{
+				if (result == SQLITE_ROW)
+				{
+					ErrorPolicy::Report("got row in databasecore statement execute<>");
+				}
+				else
+				{
+					ensureStatusCode(result, "failed to step statement");
+				}
+
+				return false;
+			}
+
+			status = SQLiteStatementStatus::Finished;
+			return true;
+		}
+
+		// like execute, but hands failures to the caller instead of the
+		// error policy
+		SQLiteResult<void> try_execute()
+		{
+			if (!can_step())
+			{
+				if (status == SQLiteStatementStatus::Failed && failure.code != SQLITE_OK)
+				{
+					return failure;
+				}
+
+				return SQLiteError{ SQLITE_MISUSE, "tried to execute statement at invalid status" };
+			}
+
+			const int result = execute_statement();
+
+			if (result == SQLITE_DONE)
+			{
+				status = SQLiteStatementStatus::Finished;
+				return { };
+			}
+
+			if (result == SQLITE_ROW)
+			{
+				return SQLiteError{ SQLITE_MISUSE, "got row in databasecore statement execute<>" };
+			}
+
+			failure = { result, sqlite3_errmsg(database->get_database()) };
+			fail();
+
+			return failure;
+		}
+
+		bool step()
+		{
+			return step(tuple);
+		}
+
+		// brings a running or finished statement back to ready so it
+		// can be stepped or executed again without preparing it again.
+		// bound values are kept until they are replaced by bind or
+		// removed by clear_bindings
+		bool reset()
 		{
-			if (status == SQLiteStatementStatus::Ready)
+			if (status == SQLiteStatementStatus::Failed)
 			{
-				step();
+				ErrorPolicy::Report("tried to reset statement after failure");
+
+				return false;
 			}
 
-			return Iterator{ this,
-				status == SQLiteStatementStatus::Running
-				? Iterator::Type::Begin
-				: Iterator::Type::End };
-		}
+			record_profile();
 
-		Iterator end()
-		{
-			return Iterator{ this, Iterator::Type::End };
+			// reset only repeats the error code of the last step, which
+			// was already reported when stepping
+			sqlite3_reset(statement);
+			status = SQLiteStatementStatus::Ready;
+			return true;
 		}
 
-		template <typename T>
-		bool execute(T& value)
+		bool clear_bindings()
 		{
-			static_assert(std::is_same_v<std::tuple<T>, Tuple>,
-				"got invalid type in databasecore statement execute<T>");
+			if (status != SQLiteStatementStatus::Ready)
+			{
+				ErrorPolicy::Report("tried to clear bindings in databasecore statement at invalid status");
 
-			return execute<Tuple>(std::make_tuple(value));
+				return false;
+			}
+
+			return ensureStatusCode(
+				sqlite3_clear_bindings(statement),
+				"failed to clear bindings");
 		}
 
-		template <>
-		bool execute<Tuple>(Tuple& tuple)
+		typedef SQLiteColumnBatch<Columns> Batch;
+
+		static constexpr size_t FetchBatchReserveLimit = 1024;
+
+		// steps up to count rows and appends them column wise to batch
+		// without building a tuple per row. returns the number of rows
+		// appended. fewer than count rows means the statement finished
+		// or failed
+		size_t fetch_batch(Batch& batch, size_t count)
 		{
-			return step(tuple) && execute();
+			static_assert(!SQLiteHasColumnView<Columns>::value,
+				"got view column in databasecore statement fetch_batch, views do not outlive the row");
+
+			size_t rows = 0;
+
+			while (rows < count && advance())
+			{
+				batch.append(statement);
+				++rows;
+			}
+
+			return rows;
 		}
 
-		bool execute()
+		// count is only an upper bound, so at most
+		// FetchBatchReserveLimit rows are reserved up front
+		Batch fetch_batch(size_t count)
 		{
-			switch (status)
-			{
-			case SQLiteStatementStatus::Failed:
-				if (OnDatabaseCoreFailure)
-					OnDatabaseCoreFailure("tried to execute statement after failure");
+			Batch batch;
+			batch.reserve(std::min(count, FetchBatchReserveLimit));
 
-				return false;
-			case SQLiteStatementStatus::Finished:
-				if (OnDatabaseCoreFailure)
-					OnDatabaseCoreFailure("tried to execute statement after finish");
+			fetch_batch(batch, count);
+			return batch;
+		}
 
-				return false;
-			}
+		typedef typename SQLiteArenaRow<Columns>::Type ArenaRow;
 
-			if (int result = sqlite3_step(statement); result != SQLITE_DONE)
-			{
-				if (result == SQLITE_ROW)
-				{
-					if (OnDatabaseCoreFailure)
-						OnDatabaseCoreFailure("got row in databasecore statement execute<>");
-				}
-				else
-				{
-					ensureStatusCode(result, "failed to step statement");
-				}
+		// appends every remaining row to rows. text and blob columns are
+		// stored in arena, so no row allocates on its own. returns the
+		// number of rows appended
+		size_t collect(SQLiteArena& arena, std::vector<ArenaRow>& rows)
+		{
+			size_t count = 0;
 
-				return false;
+			while (advance())
+			{
+				SQLiteArenaRow<Columns>::Extract(rows.emplace_back(), statement, arena);
+				++count;
 			}
 
-			status = SQLiteStatementStatus::Finished;
-			return true;
+			return count;
 		}
 
-		bool step()
+		std::vector<ArenaRow> collect(SQLiteArena& arena)
 		{
-			return step(tuple);
+			std::vector<ArenaRow> rows;
+			collect(arena, rows);
+
+			return rows;
 		}
 
 		bool can_step() const
@@ -683,42 +2387,68 @@ namespace Database
 		}
 
 		template <typename T>
-		bool bind(int index, T& value)
+		bool bind(int index, T&& value)
 		{
 			if (status != SQLiteStatementStatus::Ready)
 			{
-				if (OnDatabaseCoreFailure)
-					OnDatabaseCoreFailure("tried to bind index value in databasecore statement at invalid status");
+				ErrorPolicy::Report("tried to bind index value in databasecore statement at invalid status");
 
 				return false;
 			}
 
 			return ensureStatusCode(
-				SQLiteStatementColumn<T>::BindAs(value, index, statement),
-				L"failed to bind indexed value");
+				SQLiteStatementColumn<std::decay_t<T>>::BindAs(value, index, statement),
+				"failed to bind indexed value");
+		}
+
+		template <typename... BindArgs>
+		bool bind(BindArgs&&... args)
+		{
+			// a mapped struct binds its members without being copied
+			if constexpr (SQLiteIsMappedRow<std::decay_t<BindArgs>...>::value)
+			{
+				return bind(SQLiteRowTraits<std::decay_t<BindArgs>...>::Tie(std::as_const(args)...));
+			}
+			else
+			{
+				const std::tuple<std::decay_t<BindArgs>...> tuple{ std::forward<BindArgs>(args)... };
+				return bind(tuple);
+			}
 		}
 
-		template <typename... Args>
-		bool bind(Args&&... args)
+		template <typename... BindArgs>
+		bool bind(std::tuple<BindArgs...>& tuple)
 		{
-			std::tuple<Args...> tuple = std::make_tuple<Args...>(std::forward(args)...);
-			return bind(tuple);
+			return bind(std::as_const(tuple));
 		}
 
-		template <typename... Args>
-		bool bind(std::tuple<Args...>& tuple)
+		template <typename... BindArgs>
+		bool bind(std::tuple<BindArgs...>&& tuple)
 		{
-			if (status != SQLiteStatementStatus::Ready)
-			{
-				if (OnDatabaseCoreFailure)
-					OnDatabaseCoreFailure("tried to bind tuple in databasecore statement at invalid status");
+			return bind(std::as_const(tuple));
+		}
 
-				return false;
+		template <typename... BindArgs>
+		bool bind(const std::tuple<BindArgs...>& tuple)
+		{
+			if constexpr (SQLiteIsMappedRow<std::decay_t<BindArgs>...>::value)
+			{
+				return bind(std::get<0>(tuple));
 			}
+			else
+			{
+				if (status != SQLiteStatementStatus::Ready)
+				{
+					ErrorPolicy::Report("tried to bind tuple in databasecore statement at invalid status");
 
-			return ensureStatusCode(
-				SQLiteStatementColumnTuple<std::tuple<Args...>>::template Bind(tuple, statement),
-				"failed to bind tuple values");
+					return false;
+				}
+
+				// tied members of mapped structs are references
+				return ensureStatusCode(
+					SQLiteStatementColumnTuple<std::tuple<std::decay_t<BindArgs>...>>::Bind(tuple, statement),
+					"failed to bind tuple values");
+			}
 		}
 
 		SQLiteStatementStatus get_status() const
@@ -731,6 +2461,12 @@ namespace Database
 			return tuple;
 		}
 
+		// leaves the tuple moved from until the next step
+		Tuple&& take_tuple()
+		{
+			return std::move(tuple);
+		}
+
 		sqlite3_stmt* get_statement() const
 		{
 			return statement;
@@ -738,28 +2474,52 @@ namespace Database
 
 	private:
 		SQLiteDatabase* database;
+		// null if not profiled
+		SQLiteProfileRegistry* profiler;
+		std::string query;
 
 		SQLiteStatementStatus status;
 		Tuple tuple;
 		sqlite3_stmt* statement;
+		// the sqlite error that failed the statement, for example when
+		// it could not be prepared
+		SQLiteError failure{ SQLITE_OK, { } };
+
+		SQLiteStatementProfile profile;
+
+		// tag of this row type if the columns of statement were checked
+		const void* validated = NULL;
 
 		bool step(Tuple& tuple)
+		{
+			if (!advance())
+			{
+				return false;
+			}
+
+			auto&& columns = Traits::Tie(tuple);
+			SQLiteStatementColumnTuple<Columns>::Extract(columns, statement);
+			return true;
+		}
+
+		// steps to the next row without extracting it
+		bool advance()
 		{
 			switch (status)
 			{
 			case SQLiteStatementStatus::Failed:
-				if (OnDatabaseCoreFailure)
-					OnDatabaseCoreFailure("tried to step statement after failure");
+				ErrorPolicy::Report("tried to step statement after failure");
 
 				return false;
 			case SQLiteStatementStatus::Finished:
-				if (OnDatabaseCoreFailure)
-					OnDatabaseCoreFailure("tried to step statement after finish");
+				ErrorPolicy::Report("tried to step statement after finish");
 
 				return false;
 			}
 
-			if (int result = sqlite3_step(statement); result != SQLITE_ROW)
+			const int result = execute_statement();
+
+			if (result != SQLITE_ROW)
 			{
 				if (result == SQLITE_DONE)
 				{
@@ -776,33 +2536,337 @@ namespace Database
 			if (status == SQLiteStatementStatus::Ready)
 				status = SQLiteStatementStatus::Running;
 
-			SQLiteStatementColumnTuple<Tuple>::Extract(tuple, statement);
 			return true;
 		}
 
-		bool ensureStatusCode(int code, const char* message)
+		// a statement that has not returned a row yet can be run again
+		// from the start. inside of a transaction the conflict might be
+		// a deadlock only the other connection can resolve
+		int retry(int result)
 		{
-			if (!EnsureSQLiteStatusCode(code, message))
+			// the busy handler already waited as long as the policy allows
+			if (status != SQLiteStatementStatus::Ready
+				|| database->busy_policy.strategy == SQLiteBusyStrategy::Fail
+				|| sqlite3_get_autocommit(database->get_database()) == 0
+				|| database->busy_timed_out)
+			{
+				return result;
+			}
+
+			// sqlite3_locked does not call the busy handler, so the
+			// conflict might not be counted yet
+			if (!database->busy_counted)
+			{
+				database->begin_busy_conflict();
+			}
+
+			database->busy_retrying = true;
+
+			for (int attempt = 0; result == SQLITE_BUSY || result == SQLITE_LOCKED; ++attempt)
 			{
-				if (statement)
+				if (database->busy_timed_out
+					|| !database->wait_busy(attempt, database->busy_since))
 				{
-					EnsureSQLiteStatusCode(
-						sqlite3_finalize(statement),
-						"failed to finalize after failure");
-					statement = NULL;
+					break;
 				}
 
-				status = SQLiteStatementStatus::Failed;
-				return false;
+				// keeps the bindings
+				sqlite3_reset(statement);
+				result = step_statement();
+			}
+
+			database->busy_retrying = false;
+			return result;
+		}
+
+		static const void* GetValidationTag()
+		{
+			static const char tag = 0;
+			return &tag;
+		}
+
+		bool validate(SQLiteColumnValidation validation)
+		{
+			constexpr size_t ColumnCount = std::tuple_size_v<Columns>;
+
+			// statements without row type are only executed
+			if constexpr (ColumnCount > 0)
+			{
+				if (sqlite3_column_count(statement) != ColumnCount)
+				{
+					fail();
+					ErrorPolicy::Report("got column count not matching row type in databasecore statement");
+
+					return false;
+				}
+
+				if (validation == SQLiteColumnValidation::Types
+					&& !validateTypes(std::make_index_sequence<ColumnCount>{ }))
+				{
+					fail();
+					ErrorPolicy::Report("got declared column type not matching row type in databasecore statement");
+
+					return false;
+				}
 			}
 
+			validated = GetValidationTag();
 			return true;
 		}
+
+		template <size_t... Indices>
+		bool validateTypes(std::index_sequence<Indices...>)
+		{
+			return (SQLiteDeclaredTypeFits(
+				SQLiteColumnStorage<std::tuple_element_t<Indices, Columns>>::Value,
+				sqlite3_column_decltype(statement, Indices)) && ...);
+		}
+
+		int execute_statement()
+		{
+			// a conflict of an earlier step has ended
+			database->busy_counted = false;
+			database->busy_timed_out = false;
+
+			const int result = step_statement();
+
+			if (result == SQLITE_BUSY || result == SQLITE_LOCKED)
+			{
+				return retry(result);
+			}
+
+			return result;
+		}
+
+		int step_statement()
+		{
+			if (profiler == NULL)
+			{
+				return sqlite3_step(statement);
+			}
+
+			const auto begin = std::chrono::steady_clock::now();
+			const int result = sqlite3_step(statement);
+
+			profile.step_time += std::chrono::steady_clock::now() - begin;
+			++profile.steps;
+
+			if (result == SQLITE_ROW)
+				++profile.rows;
+
+			return result;
+		}
+
+		void record_profile()
+		{
+			if (profiler && profile.steps > 0)
+			{
+				profiler->record_execution(query, profile, statement);
+				profile = SQLiteStatementProfile{ };
+			}
+		}
+
+		bool ensureStatusCode(int code, const char* message)
+		{
+			// success never leaves the statement
+			if (code == SQLITE_OK)
+			{
+				return true;
+			}
+
+			failure = { code, sqlite3_errmsg(database->get_database()) };
+			fail();
+
+			return ErrorPolicy::Check(code, message);
+		}
+
+		void fail()
+		{
+			if (statement)
+			{
+				record_profile();
+
+				// finalize only repeats the error code of the failure
+				sqlite3_finalize(statement);
+				statement = NULL;
+			}
+
+			status = SQLiteStatementStatus::Failed;
+		}
+	};
+
+	template <typename... Args>
+	class SQLiteStatement
+		:
+		public SQLiteBasicStatement<SQLiteRowOf<Args...>>
+	{
+		typedef SQLiteBasicStatement<SQLiteRowOf<Args...>> Parent;
+
+	public:
+		using Parent::Parent;
+	};
+
+	template <typename... Args>
+	class SQLiteStatement<std::tuple<Args...>>
+		:
+		public SQLiteBasicStatement<std::tuple<Args...>>
+	{
+		typedef SQLiteBasicStatement<std::tuple<Args...>> Parent;
+
+	public:
+		using Parent::Parent;
+	};
+
+	// statements that throw SQLiteException or do not report at all
+	template <typename... Args>
+	using SQLiteThrowingStatement = SQLiteBasicStatement<SQLiteRowOf<Args...>, SQLiteErrorPolicy::Throw>;
+	template <typename... Args>
+	using SQLiteUncheckedStatement = SQLiteBasicStatement<SQLiteRowOf<Args...>, SQLiteErrorPolicy::NoCheck>;
+
+	enum class SQLiteTransactionMode
+	{
+		Deferred,
+		Immediate,
+		Exclusive
+	};
+
+	// begins a transaction on construction and rolls it back on
+	// destruction unless it was committed before
+	class SQLiteTransaction
+	{
+	public:
+		SQLiteTransaction(SQLiteDatabase* database,
+			SQLiteTransactionMode mode = SQLiteTransactionMode::Deferred);
+
+		~SQLiteTransaction()
+		{
+			if (active)
+				rollback();
+		}
+
+		SQLiteTransaction(const SQLiteTransaction&) = delete;
+		SQLiteTransaction& operator=(const SQLiteTransaction&) = delete;
+
+		// true while the transaction is open
+		operator bool() const
+		{
+			return active;
+		}
+
+		// a failed commit, for example because of SQLITE_BUSY, leaves
+		// the transaction open to be retried or rolled back
+		bool commit();
+		bool rollback();
+
+	private:
+		SQLiteDatabase* database;
+		bool active;
+	};
+
+	// nestable savepoint inside or outside of a transaction. savepoints
+	// have to end in reverse order of their creation
+	class SQLiteSavepoint
+	{
+	public:
+		SQLiteSavepoint(SQLiteDatabase* database);
+
+		~SQLiteSavepoint()
+		{
+			if (active)
+				rollback();
+		}
+
+		SQLiteSavepoint(const SQLiteSavepoint&) = delete;
+		SQLiteSavepoint& operator=(const SQLiteSavepoint&) = delete;
+
+		operator bool() const
+		{
+			return active;
+		}
+
+		// releases the savepoint
+		bool commit();
+		// rolls back to and releases the savepoint
+		bool rollback();
+
+	private:
+		SQLiteDatabase* database;
+		size_t depth;
+		bool active;
+
+		std::string name() const;
 	};
 
+	template <typename... Args, typename Range>
+	bool SQLiteDatabase::bulk_insert(std::string query, const Range& rows, size_t batch_size)
+	{
+		typedef SQLiteRowOf<Args...> Row;
+
+		assert(batch_size > 0);
+		const bool batched = sqlite3_get_autocommit(database) != 0;
+
+		SQLiteStatement<> statement(this, std::move(query));
+
+		const auto insert = [&statement](const Row& row)
+		{
+			return statement.reset() && statement.bind(row) && statement.execute();
+		};
+
+		// inside of a transaction rows are inserted as they are
+		if (!batched)
+		{
+			for (const auto& row : rows)
+			{
+				if (!insert(row))
+				{
+					return false;
+				}
+			}
+
+			return true;
+		}
+
+		auto row = std::begin(rows);
+		const auto end = std::end(rows);
+
+		while (row != end)
+		{
+			// takes the write lock up front, a deferred transaction could fail
+			// to upgrade its read lock without the busy handler being called
+			SQLiteTransaction transaction(this, SQLiteTransactionMode::Immediate);
+
+			if (!transaction)
+			{
+				return false;
+			}
+
+			for (size_t count = 0; count < batch_size && row != end; ++count, ++row)
+			{
+				// the batch is rolled back on return
+				if (!insert(*row))
+				{
+					return false;
+				}
+			}
+
+			if (!transaction.commit())
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+
 	template <typename... Args>
 	using Statement = SQLiteStatement<Args...>;
+	template <typename... Args>
+	using ThrowingStatement = SQLiteThrowingStatement<Args...>;
+	template <typename... Args>
+	using UncheckedStatement = SQLiteUncheckedStatement<Args...>;
 	using Database = SQLiteDatabase;
+	using Transaction = SQLiteTransaction;
+	using Savepoint = SQLiteSavepoint;
 
 	static_assert(sizeof(char) == 1, "DatabaseCore is written for character size 1");
 }
@@ -813,3 +2877,5 @@ using Database::SQLiteInt;
 using Database::SQLiteReal;
 using Database::SQLiteString;
 using Database::SQLiteBlob;
+using Database::SQLiteStringView;
+using Database::SQLiteBlobView;
@@ -0,0 +1,195 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <optional>
+#include <utility>
+
+namespace Database
+{
+	// unbounded lock-free queue for many producers and a single consumer
+	// (dmitry vyukov's node based queue). push never blocks, a push that
+	// is still in progress can make the queue look empty to the consumer
+	template <typename T>
+	class SQLiteMPSCQueue
+	{
+		struct Node
+		{
+			std::atomic<Node*> next{ nullptr };
+			std::optional<T> value;
+		};
+
+	public:
+		SQLiteMPSCQueue()
+			:
+			head(new Node),
+			tail(head.load())
+		{
+		}
+
+		~SQLiteMPSCQueue()
+		{
+			T value;
+			while (try_pop(value));
+
+			delete tail;
+		}
+
+		SQLiteMPSCQueue(const SQLiteMPSCQueue&) = delete;
+		SQLiteMPSCQueue& operator=(const SQLiteMPSCQueue&) = delete;
+
+		// any thread
+		void push(T value)
+		{
+			Node* const node = new Node;
+			node->value.emplace(std::move(value));
+
+			Node* const previous = head.exchange(node);
+			previous->next.store(node);
+		}
+
+		// consumer thread only
+		bool try_pop(T& value)
+		{
+			Node* const next = tail->next.load();
+
+			if (next == nullptr)
+			{
+				return false;
+			}
+
+			// next becomes the new empty node
+			value = std::move(*next->value);
+			next->value.reset();
+
+			delete tail;
+			tail = next;
+
+			return true;
+		}
+
+		// consumer thread only
+		bool empty() const
+		{
+			return tail->next.load() == nullptr;
+		}
+
+	private:
+		// producers append at head, the consumer removes at tail. tail
+		// always points to an empty node
+		std::atomic<Node*> head;
+		Node* tail;
+	};
+
+	// SQLiteMPSCQueue for a single worker thread that sleeps while the
+	// queue is empty. producers only take the lock to wake a sleeping
+	// worker
+	template <typename T>
+	class SQLiteWorkQueue
+	{
+	public:
+		typedef std::chrono::steady_clock Clock;
+
+		// any thread
+		void push(T value)
+		{
+			queue.push(std::move(value));
+
+			// pairs with the store of sleeping in wait. either the worker
+			// sees the value or the producer sees the sleeping worker
+			if (sleeping)
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				condition.notify_one();
+			}
+		}
+
+		// any thread. the worker drains remaining values before pop
+		// returns false
+		void stop()
+		{
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				stopping = true;
+			}
+
+			condition.notify_one();
+		}
+
+		// worker thread only
+		bool try_pop(T& value)
+		{
+			return queue.try_pop(value);
+		}
+
+		// worker thread only. waits for the next value. false once
+		// stopped and empty
+		bool pop(T& value)
+		{
+			while (!queue.try_pop(value))
+			{
+				if (stopping)
+				{
+					return false;
+				}
+
+				wait(NULL);
+			}
+
+			return true;
+		}
+
+		// worker thread only. like pop, but also false if no value was
+		// pushed before deadline
+		bool pop_until(T& value, Clock::time_point deadline)
+		{
+			while (!queue.try_pop(value))
+			{
+				if (stopping || !wait(&deadline))
+				{
+					return false;
+				}
+			}
+
+			return true;
+		}
+
+	private:
+		SQLiteMPSCQueue<T> queue;
+
+		std::atomic<bool> stopping{ false };
+		std::atomic<bool> sleeping{ false };
+
+		std::mutex mutex;
+		std::condition_variable condition;
+
+		// false if deadline passed before a value was pushed
+		bool wait(const Clock::time_point* deadline)
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+
+			sleeping = true;
+
+			const auto ready = [this]()
+			{
+				return stopping || !queue.empty();
+			};
+
+			bool woken = true;
+
+			if (deadline)
+			{
+				woken = condition.wait_until(lock, *deadline, ready);
+			}
+			else
+			{
+				condition.wait(lock, ready);
+			}
+
+			sleeping = false;
+			return woken;
+		}
+	};
+}
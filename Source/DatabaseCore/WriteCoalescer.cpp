@@ -0,0 +1,140 @@
+#include "WriteCoalescer.h"
+
+#include <algorithm>
+
+namespace Database
+{
+	SQLiteWriteCoalescer::SQLiteWriteCoalescer(
+		std::string filename,
+		const SQLiteOpenOptions& options,
+		const SQLiteWriteCoalescerOptions& coalescer_options)
+		:
+		coalescer_options(coalescer_options)
+	{
+		this->coalescer_options.max_batch_size = std::max<size_t>(coalescer_options.max_batch_size, 1);
+
+		std::promise<bool> open_promise;
+		std::future<bool> open_future = open_promise.get_future();
+
+		worker = std::thread(&SQLiteWriteCoalescer::run, this,
+			std::move(filename), options, std::move(open_promise));
+
+		opened = open_future.get();
+	}
+
+	SQLiteWriteCoalescer::~SQLiteWriteCoalescer()
+	{
+		queue.stop();
+		worker.join();
+	}
+
+	void SQLiteWriteCoalescer::push(std::unique_ptr<SQLiteWriteRequest> request)
+	{
+		if (!opened)
+		{
+			if (OnDatabaseCoreFailure)
+				OnDatabaseCoreFailure("tried to write to unopened write coalescer");
+
+			return;
+		}
+
+		queue.push(std::move(request));
+	}
+
+	void SQLiteWriteCoalescer::run(
+		std::string filename,
+		SQLiteOpenOptions options,
+		std::promise<bool> open_promise)
+	{
+		SQLiteDatabase database(std::move(filename), options);
+		open_promise.set_value((bool) database);
+
+		if (!database)
+		{
+			return;
+		}
+
+		Batch batch;
+		batch.reserve(coalescer_options.max_batch_size);
+
+		while (collect(batch))
+		{
+			commit(database, batch);
+			batch.clear();
+		}
+	}
+
+	bool SQLiteWriteCoalescer::collect(Batch& batch)
+	{
+		std::unique_ptr<SQLiteWriteRequest> request;
+
+		if (!queue.pop(request))
+		{
+			return false;
+		}
+
+		batch.push_back(std::move(request));
+
+		// the window starts with the first write, so a single write waits
+		// at most window long
+		const Clock::time_point deadline = Clock::now() + coalescer_options.window;
+
+		while (batch.size() < coalescer_options.max_batch_size
+			&& queue.pop_until(request, deadline))
+		{
+			batch.push_back(std::move(request));
+		}
+
+		return true;
+	}
+
+	void SQLiteWriteCoalescer::commit(SQLiteDatabase& database, Batch& batch)
+	{
+		std::vector<bool> results(batch.size());
+		size_t transaction_begin = 0;
+
+		// if begin fails every statement runs in its own transaction
+		std::optional<SQLiteTransaction> transaction;
+
+		const auto begin = [this, &database, &transaction]()
+		{
+			if (transaction.emplace(&database, SQLiteTransactionMode::Immediate))
+			{
+				transactions.fetch_add(1, std::memory_order_relaxed);
+			}
+		};
+
+		begin();
+
+		for (size_t i = 0; i < batch.size(); ++i)
+		{
+			results[i] = batch[i]->execute(database);
+
+			// some errors make sqlite roll back the whole transaction. the
+			// writes before are lost, the rest continues in a new one
+			if (!results[i] && *transaction && sqlite3_get_autocommit(database.get_database()) != 0)
+			{
+				std::fill(results.begin() + transaction_begin, results.begin() + i + 1, false);
+
+				begin();
+				transaction_begin = i + 1;
+			}
+		}
+
+		if (*transaction && !transaction->commit())
+		{
+			std::fill(results.begin() + transaction_begin, results.end(), false);
+		}
+
+		// rolls back after a failed commit
+		transaction.reset();
+
+		// counted first, so statistics include writes whose futures are ready
+		writes.fetch_add(batch.size(), std::memory_order_relaxed);
+
+		for (size_t i = 0; i < batch.size(); ++i)
+		{
+			batch[i]->complete(results[i]);
+		}
+	}
+}
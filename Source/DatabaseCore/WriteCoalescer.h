@@ -0,0 +1,160 @@
+#pragma once
+
+#include "DatabaseCore.h"
+#include "MPSCQueue.h"
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <memory>
+#include <thread>
+
+namespace Database
+{
+	struct SQLiteWriteCoalescerOptions
+	{
+		// a transaction is committed once its first write waited window
+		// long or once it holds max_batch_size writes
+		std::chrono::microseconds window{ 1000 };
+		size_t max_batch_size = 1024;
+	};
+
+	struct SQLiteWriteCoalescerStatistics
+	{
+		size_t writes;
+		// every transaction begun, including the ones restarted after a
+		// write rolled back its batch
+		size_t transactions;
+	};
+
+	class SQLiteWriteRequest
+	{
+	public:
+		virtual ~SQLiteWriteRequest() = default;
+
+		virtual bool execute(SQLiteDatabase& database) = 0;
+
+		void complete(bool result)
+		{
+			promise.set_value(result);
+		}
+
+		std::future<bool> get_future()
+		{
+			return promise.get_future();
+		}
+
+	private:
+		std::promise<bool> promise;
+	};
+
+	template <typename Tuple>
+	class SQLiteWriteStatementRequest
+		:
+		public SQLiteWriteRequest
+	{
+	public:
+		SQLiteWriteStatementRequest(std::string query, Tuple arguments)
+			:
+			query(std::move(query)),
+			arguments(std::move(arguments))
+		{
+		}
+
+		// statements of the same query are reused through the statement
+		// cache of the connection
+		bool execute(SQLiteDatabase& database) override
+		{
+			SQLiteStatement<> statement(&database, query);
+
+			if constexpr (std::tuple_size_v<Tuple> > 0)
+			{
+				if (!statement.bind(arguments))
+				{
+					return false;
+				}
+			}
+
+			return statement.execute();
+		}
+
+	private:
+		std::string query;
+		Tuple arguments;
+	};
+
+	// gathers single statement writes of many threads and commits them
+	// together in one transaction, so they share one lock and one sync
+	// instead of contending for the database. every writer gets the
+	// result of its own statement. a write fails alone if its statement
+	// fails, unless sqlite rolls back the whole transaction for it
+	class SQLiteWriteCoalescer
+	{
+	public:
+		typedef std::chrono::steady_clock Clock;
+
+		// blocks until the worker opened the database
+		SQLiteWriteCoalescer(std::string filename,
+			const SQLiteOpenOptions& options = { },
+			const SQLiteWriteCoalescerOptions& coalescer_options = { });
+
+		// commits all remaining writes before returning
+		~SQLiteWriteCoalescer();
+
+		SQLiteWriteCoalescer(const SQLiteWriteCoalescer&) = delete;
+		SQLiteWriteCoalescer& operator=(const SQLiteWriteCoalescer&) = delete;
+
+		operator bool() const
+		{
+			return opened;
+		}
+
+		// queues query with its arguments. the future is true once the
+		// statement ran and its transaction was committed. if the
+		// database could not be opened the future reports a broken promise
+		template <typename... Args>
+		std::future<bool> write(std::string query, Args&&... args)
+		{
+			typedef std::tuple<std::decay_t<Args>...> Tuple;
+
+			auto request = std::make_unique<SQLiteWriteStatementRequest<Tuple>>(
+				std::move(query),
+				Tuple{ std::forward<Args>(args)... });
+			auto future = request->get_future();
+
+			push(std::move(request));
+			return future;
+		}
+
+		SQLiteWriteCoalescerStatistics get_statistics() const
+		{
+			return SQLiteWriteCoalescerStatistics
+			{
+				writes.load(std::memory_order_relaxed),
+				transactions.load(std::memory_order_relaxed)
+			};
+		}
+
+	private:
+		typedef std::vector<std::unique_ptr<SQLiteWriteRequest>> Batch;
+
+		void push(std::unique_ptr<SQLiteWriteRequest> request);
+
+		void run(std::string filename, SQLiteOpenOptions options, std::promise<bool> open_promise);
+		// false once stopped and drained
+		bool collect(Batch& batch);
+		void commit(SQLiteDatabase& database, Batch& batch);
+
+		SQLiteWriteCoalescerOptions coalescer_options;
+		bool opened = false;
+
+		SQLiteWorkQueue<std::unique_ptr<SQLiteWriteRequest>> queue;
+
+		std::atomic<size_t> writes{ 0 };
+		std::atomic<size_t> transactions{ 0 };
+
+		std::thread worker;
+	};
+
+	using WriteCoalescer = SQLiteWriteCoalescer;
+}
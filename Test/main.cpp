@@ -1,8 +1,16 @@
+#include "DatabaseCore/AsyncDatabase.h"
 #include "DatabaseCore/DatabaseCore.h"
+
+#include <algorithm>
+#include <atomic>
 #include <iostream>
+#include <thread>
 
 void example_1(Database::Database& database);
 void example_2(Database::Database& database);
+void example_3(Database::Database& database);
+void example_4();
+void example_5();
 
 /*
 
@@ -13,6 +21,16 @@ Output:
 	3 : Tree Hello
 	example_2:
 	name of 2 is Hello Two
+	example_3:
+	1 -> Hello World
+	3 -> Tree Hello
+	example_4:
+	tuned with column validation
+	2 rows
+	example_5:
+	800 writes and 800 reads completed
+	800 rows
+	0 tasks after destruction
 
 */
 
@@ -31,6 +49,15 @@ int main()
 
 	std::cout << "example_2:" << std::endl;
 	example_2(db);
+
+	std::cout << "example_3:" << std::endl;
+	example_3(db);
+
+	std::cout << "example_4:" << std::endl;
+	example_4();
+
+	std::cout << "example_5:" << std::endl;
+	example_5();
 }
 
 void example_1(Database::Database& database)
@@ -39,9 +66,11 @@ void example_1(Database::Database& database)
 		&database,
 		"SELECT id, name FROM test");
 
-	for (auto row : statement)
+	// rows are references into the statement. take them with
+	// statement.consume() to keep them
+	for (const auto& [id, name] : statement)
 	{
-		std::cout << std::get<0>(row) << " : " << std::get<1>(row) << std::endl;
+		std::cout << id << " : " << name << std::endl;
 	}
 
 	if (!statement)
@@ -68,3 +97,153 @@ void example_2(Database::Database& database)
 
 	std::cout << "name of " << test_id << " is " << std::get<0>(result) << std::endl;
 }
+
+void example_3(Database::Database& database)
+{
+	// prepared once, reset and rebound for every lookup
+	Database::Statement<SQLiteString> statement(
+		&database,
+		"SELECT name FROM test WHERE id = ?");
+
+	for (SQLiteInt id : { 1, 3 })
+	{
+		SQLiteString name;
+
+		if (!statement.reset() || !statement.bind(id) || !statement.execute(name))
+		{
+			std::cout << "Statement failed" << std::endl;
+			return;
+		}
+
+		std::cout << id << " -> " << name << std::endl;
+	}
+}
+
+void example_4()
+{
+	Database::Database database(":memory:");
+
+	// statements are checked against their row type when prepared
+	database.set_column_validation(Database::SQLiteColumnValidation::Types);
+
+	if (!database.tune(Database::SQLiteTuning::BulkLoad()))
+	{
+		std::cout << "Tuning failed" << std::endl;
+		return;
+	}
+
+	std::cout << "tuned with column validation" << std::endl;
+
+	std::vector<std::tuple<SQLiteInt, SQLiteString>> rows =
+	{
+		{ 1, "one" },
+		{ 2, "two" }
+	};
+
+	SQLiteInt count = 0;
+
+	if (!Database::Statement<>(&database, "CREATE TABLE numbers (id INTEGER, name TEXT)").execute()
+		|| !database.bulk_insert<SQLiteInt, SQLiteString>("INSERT INTO numbers VALUES (?, ?)", rows)
+		|| !Database::Statement<SQLiteInt>(&database, "SELECT count(*) FROM numbers").execute(count))
+	{
+		std::cout << "Statement failed" << std::endl;
+		return;
+	}
+
+	std::cout << count << " rows" << std::endl;
+}
+
+void example_5()
+{
+	constexpr int ThreadCount = 8;
+	constexpr int TaskCount = 100;
+
+	std::vector<std::future<bool>> writes[ThreadCount];
+	std::vector<std::future<SQLiteInt>> reads[ThreadCount];
+
+	std::atomic<bool> destroyed{ false };
+	std::atomic<int> late_tasks{ 0 };
+
+	{
+		Database::AsyncDatabase database(":memory:");
+
+		if (!database || !database.submit_write([](Database::Database& database)
+			{
+				return Database::Statement<>(&database, "CREATE TABLE numbers (value INTEGER)").execute();
+			}).get())
+		{
+			std::cout << "Async database failed" << std::endl;
+			return;
+		}
+
+		// producers push concurrently, so the worker has to pick up
+		// tasks pushed while it falls asleep
+		std::vector<std::thread> producers;
+
+		for (int thread = 0; thread < ThreadCount; ++thread)
+		{
+			producers.emplace_back([&, thread]()
+				{
+					for (int task = 0; task < TaskCount; ++task)
+					{
+						writes[thread].push_back(database.submit_write(
+							[&, value = thread * TaskCount + task](Database::Database& database)
+							{
+								late_tasks += destroyed;
+
+								return Database::Statement<>(&database,
+									"INSERT INTO numbers VALUES (?)", value).execute();
+							}));
+
+						reads[thread].push_back(database.submit(
+							[&](Database::Database& database)
+							{
+								late_tasks += destroyed;
+
+								SQLiteInt count = 0;
+								Database::Statement<SQLiteInt>(&database,
+									"SELECT count(*) FROM numbers").execute(count);
+
+								return count;
+							}));
+					}
+				});
+		}
+
+		for (std::thread& producer : producers)
+		{
+			producer.join();
+		}
+
+		// the destructor runs every remaining task
+	}
+
+	destroyed = true;
+
+	int completed_writes = 0;
+	int completed_reads = 0;
+	SQLiteInt rows = 0;
+
+	for (int thread = 0; thread < ThreadCount; ++thread)
+	{
+		for (std::future<bool>& write : writes[thread])
+		{
+			if (write.wait_for(std::chrono::seconds(0)) == std::future_status::ready && write.get())
+				++completed_writes;
+		}
+
+		for (std::future<SQLiteInt>& read : reads[thread])
+		{
+			if (read.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+			{
+				// the last read ran after every write
+				rows = std::max(rows, read.get());
+				++completed_reads;
+			}
+		}
+	}
+
+	std::cout << completed_writes << " writes and " << completed_reads << " reads completed" << std::endl;
+	std::cout << rows << " rows" << std::endl;
+	std::cout << late_tasks << " tasks after destruction" << std::endl;
+}